@@ -0,0 +1,177 @@
+//!  A bit planes class.
+/*!
+    Functions that transpose carrier bytes into bit planes, with 64-bit delta swaps or GFNI.
+*/
+
+#include <cstring>
+
+#include "BitPlanes.h"
+#include "LsbKernels.h"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+//! A function variable.
+/*!
+  A function that reverses the byte order of a 64-bit word.
+*/
+static inline uint64_t swapBytes(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap64(v);
+#else
+    v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+    v = ((v >> 16) & 0x0000FFFF0000FFFFULL) | ((v & 0x0000FFFF0000FFFFULL) << 16);
+    return (v >> 32) | (v << 32);
+#endif
+}
+
+//! A function variable.
+/*!
+  A function that transposes an 8x8 bit matrix with three delta swaps.
+  The bytes are swapped first, so carrier byte 0 ends up in the most significant bit of every plane byte.
+*/
+uint64_t transposeBitMatrix8x8(uint64_t carriers) {
+    uint64_t x = swapBytes(carriers);
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+//! A function variable.
+/*!
+  A function that returns the 8 plane bytes of a group of 8 carrier bytes, byte p holding plane p.
+  The delta-swap transpose takes the group as one word with carrier byte 0 in the low 8 bits, which is how a
+  little-endian load reads it; big-endian targets collect the bits one at a time instead.
+*/
+static inline uint64_t transposeGroup(const uint8_t* group) {
+#ifdef CPU_LITTLE_ENDIAN
+    uint64_t word;
+    memcpy(&word, group, sizeof(word));
+    return transposeBitMatrix8x8(word);
+#else
+    uint64_t transposed = 0;
+    for(int j = 0; j < 8; ++j) {
+        for(int p = 0; p < 8; ++p) {
+            transposed |= (uint64_t)((group[j] >> p) & 1) << (8 * p + 7 - j);
+        }
+    }
+    return transposed;
+#endif
+}
+
+//! A function variable.
+/*!
+  A function that transposes groups of 8 carrier bytes without vector instructions, one plane byte per plane and group.
+*/
+static void transposeGroupsPortable(const uint8_t* carrier, size_t firstGroup, size_t groups, uint8_t* const planes[8]) {
+    for(size_t g = firstGroup; g < firstGroup + groups; ++g) {
+        uint64_t transposed = transposeGroup(carrier + g * 8);
+        for(int p = 0; p < 8; ++p) {
+            if(planes[p] != nullptr) {
+                planes[p][g] = (uint8_t)(transposed >> (8 * p));
+            }
+        }
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that transposes blocks of 64 carrier bytes with GFNI.
+  gf2p8affineqb with the carriers as the matrix and bytes 1 << p as the operand turns every 64-bit group
+  into its 8 plane bytes; an 8x8 byte transpose built from unpacks then gives 8 bytes of every plane.
+*/
+CPU_TARGET("gfni,sse2")
+static void transposeBlocksGfni(const uint8_t* carrier, size_t blocks, uint8_t* const planes[8]) {
+    const __m128i select = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+    for(size_t b = 0; b < blocks; ++b) {
+        const __m128i* src = (const __m128i*)(carrier + b * 64);
+        __m128i a0 = _mm_gf2p8affine_epi64_epi8(select, _mm_loadu_si128(src), 0);
+        __m128i a1 = _mm_gf2p8affine_epi64_epi8(select, _mm_loadu_si128(src + 1), 0);
+        __m128i a2 = _mm_gf2p8affine_epi64_epi8(select, _mm_loadu_si128(src + 2), 0);
+        __m128i a3 = _mm_gf2p8affine_epi64_epi8(select, _mm_loadu_si128(src + 3), 0);
+
+        __m128i b0 = _mm_unpacklo_epi8(a0, _mm_unpackhi_epi64(a0, a0));
+        __m128i b1 = _mm_unpacklo_epi8(a1, _mm_unpackhi_epi64(a1, a1));
+        __m128i b2 = _mm_unpacklo_epi8(a2, _mm_unpackhi_epi64(a2, a2));
+        __m128i b3 = _mm_unpacklo_epi8(a3, _mm_unpackhi_epi64(a3, a3));
+
+        __m128i c0 = _mm_unpacklo_epi16(b0, b1);
+        __m128i c1 = _mm_unpackhi_epi16(b0, b1);
+        __m128i c2 = _mm_unpacklo_epi16(b2, b3);
+        __m128i c3 = _mm_unpackhi_epi16(b2, b3);
+
+        __m128i rows[4] = {
+            _mm_unpacklo_epi32(c0, c2),
+            _mm_unpackhi_epi32(c0, c2),
+            _mm_unpacklo_epi32(c1, c3),
+            _mm_unpackhi_epi32(c1, c3)
+        };
+        for(int r = 0; r < 4; ++r) {
+            if(planes[2 * r] != nullptr) {
+                _mm_storel_epi64((__m128i*)(planes[2 * r] + b * 8), rows[r]);
+            }
+            if(planes[2 * r + 1] != nullptr) {
+                _mm_storel_epi64((__m128i*)(planes[2 * r + 1] + b * 8), _mm_unpackhi_epi64(rows[r], rows[r]));
+            }
+        }
+    }
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that transposes the carrier bytes into the plane buffers.
+  GFNI is only used when the CPU has it and the dispatch was not forced to the portable kernels.
+*/
+void transposeBitPlanes(const uint8_t* carrier, size_t carrierSize, uint8_t* const planes[8]) {
+    size_t groups = carrierSize / 8;
+    size_t done = 0;
+#ifdef CPU_FEATURES_X86
+    InstructionSet isa = activeInstructionSet();
+    if(isGfniSupported() && isa != InstructionSet::SCALAR && isa != InstructionSet::SWAR) {
+        size_t blocks = groups / 8;
+        transposeBlocksGfni(carrier, blocks, planes);
+        done = blocks * 8;
+    }
+#endif
+    transposeGroupsPortable(carrier, done, groups - done, planes);
+
+    size_t rest = carrierSize - groups * 8;
+    if(rest != 0) {
+        uint8_t tail[8] = {0};
+        memcpy(tail, carrier + groups * 8, rest);
+        uint64_t transposed = transposeGroup(tail);
+        for(int p = 0; p < 8; ++p) {
+            if(planes[p] != nullptr) {
+                planes[p][groups] = (uint8_t)(transposed >> (8 * p));
+            }
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the bit planes of the image selected by planeMask.
+*/
+BitPlanes extractBitPlanes(const Image& image, uint8_t planeMask) {
+    BitPlanes result;
+    result.bitCount = image.size;
+    uint8_t* planes[8] = {nullptr};
+    for(int p = 0; p < 8; ++p) {
+        if((planeMask >> p) & 1) {
+            result.planes[p].resize((image.size + 7) / 8);
+            planes[p] = result.planes[p].data();
+        }
+    }
+    if(image.data != nullptr) {
+        transposeBitPlanes(image.data, image.size, planes);
+    }
+    return result;
+}
@@ -0,0 +1,45 @@
+//!  A bit planes class.
+/*!
+  A structure with the eight bit planes of an image and functions that transpose carrier bytes into bit planes.
+  Plane p holds bit p of every carrier byte, packed 8 carrier bytes per plane byte with the first one
+  in the most significant bit, the same order the payload is embedded in.
+*/
+
+#ifndef ImageSteganography_BIT_PLANES_H
+#define ImageSteganography_BIT_PLANES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Image.h"
+
+//! A structure.
+/*! A structure that stores the bit planes of an image. */
+struct BitPlanes {
+    size_t bitCount = 0; //!< A variable that stores the number of bits in every plane (the number of carrier bytes).
+    std::vector<uint8_t> planes[8]; //!< A variable that stores the packed planes, planes[0] is the LSB plane. Planes that were not requested are empty.
+};
+
+//! A function variable.
+/*!
+  A function that transposes an 8x8 bit matrix: 8 carrier bytes in (byte j of the word is carrier byte j),
+  8 plane bytes out (byte p of the result is the plane p byte), with the classic 64-bit delta swaps.
+*/
+uint64_t transposeBitMatrix8x8(uint64_t carriers);
+
+//! A function variable.
+/*!
+  A function that transposes carrierSize carrier bytes into the 8 plane buffers, (carrierSize + 7) / 8 bytes each.
+  A null plane pointer skips that plane. The last plane byte is padded with zero bits.
+  It uses gf2p8affineqb when the CPU has GFNI and the delta-swap transpose otherwise.
+*/
+void transposeBitPlanes(const uint8_t* carrier, size_t carrierSize, uint8_t* const planes[8]);
+
+//! A function variable.
+/*!
+  A function that returns the bit planes of the image selected by planeMask (bit p selects plane p).
+*/
+BitPlanes extractBitPlanes(const Image& image, uint8_t planeMask = 0xFF);
+
+#endif //ImageSteganography_BIT_PLANES_H
@@ -0,0 +1,211 @@
+//!  A carrier layout structure.
+/*!
+    A structure that parses BMP, TGA and PPM headers the way stbi_load reads them and converts between stored rows and image rows.
+*/
+
+#include "CarrierLayout.h"
+#include "Image.h"
+
+#define PNM_MAX_DIMENSION (1 << 24)
+
+//! A function variable.
+/*!
+  A function that loads a little-endian 16-bit number.
+*/
+static uint32_t getLittleEndian16(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8);
+}
+
+//! A function variable.
+/*!
+  A function that loads a little-endian 32-bit number.
+*/
+static uint32_t getLittleEndian32(const uint8_t* bytes) {
+    return getLittleEndian16(bytes) | (getLittleEndian16(bytes + 2) << 16);
+}
+
+//! A function variable.
+/*!
+  A function that parses a BMP header the way stbi_load reads it: 24-bit BI_RGB files are BGR,
+  32-bit files with the default or the standard BI_BITFIELDS masks are BGRA. Positive heights are stored bottom-up
+  and rows are padded to 4 bytes.
+  Return type: boolean.
+*/
+bool CarrierLayout::parseBmp(const uint8_t* header, size_t headerSize) {
+    if(headerSize < 54 || header[0] != 'B' || header[1] != 'M') {
+        return false;
+    }
+    uint32_t infoSize = getLittleEndian32(header + 14);
+    int32_t storedHeight = (int32_t)getLittleEndian32(header + 22);
+    uint32_t bitsPerPixel = getLittleEndian16(header + 28);
+    uint32_t compression = getLittleEndian32(header + 30);
+    bool versioned = infoSize == 108 || infoSize == 124;
+    if((infoSize != 40 && infoSize != 56 && !versioned) || getLittleEndian16(header + 26) != 1) {
+        return false;
+    }
+    dataOffset = getLittleEndian32(header + 10);
+    width = (int32_t)getLittleEndian32(header + 18);
+    height = storedHeight < 0 ? -storedHeight : storedHeight;
+    bottomUp = storedHeight > 0;
+
+    if(bitsPerPixel == 24 && compression == 0) {
+        channels = 3;
+    }
+    else if(bitsPerPixel == 32 && compression == 0) {
+        channels = 4;
+        alphaMayBeReplaced = true;
+    }
+    else if(bitsPerPixel == 32 && compression == 3 && versioned && headerSize >= 70
+            && getLittleEndian32(header + 54) == 0x00FF0000 && getLittleEndian32(header + 58) == 0x0000FF00
+            && getLittleEndian32(header + 62) == 0x000000FF && getLittleEndian32(header + 66) == 0xFF000000) {
+        channels = 4;
+    }
+    else {
+        return false;
+    }
+    channelOffset[0] = 2;
+    channelOffset[2] = 0;
+    rowStride = ((size_t)width * channels + 3) & ~(size_t)3;
+    return dataOffset >= 14 + infoSize;
+}
+
+//! A function variable.
+/*!
+  A function that parses a TGA header the way stbi_load reads it: uncompressed true-colour images
+  are BGR(A), uncompressed grey images are grey or grey-alpha. Rows are stored bottom-up unless bit 5 of the
+  descriptor is set.
+  Return type: boolean.
+*/
+bool CarrierLayout::parseTga(const uint8_t* header, size_t headerSize) {
+    if(headerSize < 18 || header[1] != 0) {
+        return false;
+    }
+    int imageType = header[2];
+    int bitsPerPixel = header[16];
+    if(imageType == 2 && (bitsPerPixel == 24 || bitsPerPixel == 32)) {
+        channelOffset[0] = 2;
+        channelOffset[2] = 0;
+    }
+    else if(imageType != 3 || (bitsPerPixel != 8 && bitsPerPixel != 16)) {
+        return false;
+    }
+    channels = bitsPerPixel / 8;
+    width = (int)getLittleEndian16(header + 12);
+    height = (int)getLittleEndian16(header + 14);
+    bottomUp = (header[17] & 0x20) == 0;
+    dataOffset = 18 + header[0];
+    rowStride = (size_t)width * channels;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that parses a binary PGM (P5) or PPM (P6) header the way stbi_load reads it: the width, height and
+  maximum value follow the magic, separated by whitespace and '#' comments, and a single whitespace byte ends the header.
+  Rows are stored top-down without padding. Files with a maximum value over 255 have 16-bit samples and are rejected.
+  Return type: boolean.
+*/
+bool CarrierLayout::parsePpm(const uint8_t* header, size_t headerSize) {
+    if(headerSize < 3 || header[0] != 'P' || (header[1] != '5' && header[1] != '6')) {
+        return false;
+    }
+    size_t pos = 2;
+    int c = header[pos++];
+    auto skipWhitespace = [&]() {
+        for(;;) {
+            while(c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r') {
+                c = pos < headerSize ? header[pos++] : -1;
+            }
+            if(c != '#') {
+                return;
+            }
+            while(c != -1 && c != '\n' && c != '\r') {
+                c = pos < headerSize ? header[pos++] : -1;
+            }
+        }
+    };
+    auto getInteger = [&]() {
+        int value = 0;
+        while(c >= '0' && c <= '9' && value <= PNM_MAX_DIMENSION) {
+            value = value * 10 + (c - '0');
+            c = pos < headerSize ? header[pos++] : -1;
+        }
+        return value;
+    };
+    skipWhitespace();
+    width = getInteger();
+    skipWhitespace();
+    height = getInteger();
+    skipWhitespace();
+    int maxValue = getInteger();
+    if(c == -1 || width > PNM_MAX_DIMENSION || height > PNM_MAX_DIMENSION || maxValue > 255) {
+        return false;
+    }
+    channels = header[1] == '6' ? 3 : 1;
+    dataOffset = pos;
+    rowStride = (size_t)width * channels;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that picks the parser by the magic of the file, or by its extension for TGA, which has no magic.
+  Return type: boolean.
+*/
+bool CarrierLayout::parse(const uint8_t* header, size_t headerSize, const char* filename, uint64_t fileSize) {
+    bool parsed = false;
+    if(headerSize >= 2 && header[0] == 'B' && header[1] == 'M') {
+        parsed = parseBmp(header, headerSize);
+    }
+    else if(headerSize >= 2 && header[0] == 'P' && (header[1] == '5' || header[1] == '6')) {
+        parsed = parsePpm(header, headerSize);
+    }
+    else if(Image::getFileType(filename) == ImageType::TGA) {
+        parsed = parseTga(header, headerSize);
+    }
+    if(!parsed || width <= 0 || height <= 0) {
+        return false;
+    }
+    return dataOffset + (uint64_t)rowStride * height <= fileSize;
+}
+
+//! A function variable.
+/*!
+  A function that returns the file offset of the row stbi_load puts at index y.
+*/
+uint64_t CarrierLayout::rowOffset(int y) const {
+    return dataOffset + (uint64_t)(bottomUp ? height - 1 - y : y) * rowStride;
+}
+
+//! A function variable.
+/*!
+  A function that tells whether the stored rows are the image itself.
+  Return type: boolean.
+*/
+bool CarrierLayout::isDirect() const {
+    return !bottomUp && rowStride == (size_t)width * channels && channelOffset[0] == 0;
+}
+
+//! A function variable.
+/*!
+  A function that copies the channels of every pixel of a stored row to their places in the image row.
+*/
+void CarrierLayout::toImageRow(const uint8_t* stored, uint8_t* row) const {
+    for(int x = 0; x < width; ++x) {
+        for(int c = 0; c < channels; ++c) {
+            row[x * channels + c] = stored[x * channels + channelOffset[c]];
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that copies the channels of every pixel of an image row to their places in the stored row.
+*/
+void CarrierLayout::toStoredRow(const uint8_t* row, uint8_t* stored) const {
+    for(int x = 0; x < width; ++x) {
+        for(int c = 0; c < channels; ++c) {
+            stored[x * channels + channelOffset[c]] = row[x * channels + c];
+        }
+    }
+}
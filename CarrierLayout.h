@@ -0,0 +1,88 @@
+//!  A carrier layout structure.
+/*!
+  A structure that describes where the pixels of an uncompressed BMP, TGA or PPM file are stored:
+  the offset of the first row, the row stride with its padding, the row order and the byte order of the channels.
+  It maps those stored rows to the rows stbi_load returns (top-down, RGB(A)), so the pixels can be read
+  and patched in the file without decoding it.
+*/
+
+#ifndef ImageSteganography_CARRIER_LAYOUT_H
+#define ImageSteganography_CARRIER_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define CARRIER_HEADER_READ_SIZE 256 //!< The number of bytes at the start of a file the headers are parsed from.
+
+//! A structure.
+/*! A structure that stores the stored pixel layout of an uncompressed BMP, TGA or PPM file. */
+struct CarrierLayout {
+    int width = 0; //!< A variable that stores the image width.
+    int height = 0; //!< A variable that stores the image height.
+    int channels = 0; //!< A variable that stores the number of channels, as stbi_load reports them.
+    uint64_t dataOffset = 0; //!< A variable that stores the file offset of the first stored row.
+    size_t rowStride = 0; //!< A variable that stores the bytes of a stored row, padding included.
+    bool bottomUp = false; //!< A variable that tells whether the last row of the image is stored first.
+    int channelOffset[4] = {0, 1, 2, 3}; //!< A variable that stores where channel c of a pixel sits in the stored pixel.
+    bool alphaMayBeReplaced = false; //!< A variable that tells whether stbi_load replaces an all-zero alpha channel by 255.
+
+    //! A function variable.
+    /*!
+      A function that parses the header of a BMP (found by its magic), a binary PPM or PGM (found by its magic)
+      or a TGA (found by the extension of the filename) and checks that the rows fit in a file of fileSize bytes.
+      It fails for everything but 24/32-bit BMPs with the standard channel masks, 8-bit P5/P6 files and uncompressed
+      8/16/24/32-bit true-colour or grey TGAs; stbi_load converts the pixels of the other files on loading.
+      Return type: boolean.
+    */
+    bool parse(const uint8_t* header, size_t headerSize, const char* filename, uint64_t fileSize);
+
+    //! A function variable.
+    /*!
+      A function that returns the file offset of the row stbi_load puts at index y.
+    */
+    uint64_t rowOffset(int y) const;
+
+    //! A function variable.
+    /*!
+      A function that tells whether the stored rows are byte for byte the image stbi_load returns:
+      top-down, without padding and with the channels in order.
+      Return type: boolean.
+    */
+    bool isDirect() const;
+
+    //! A function variable.
+    /*!
+      A function that converts a stored row to a row of the image.
+    */
+    void toImageRow(const uint8_t* stored, uint8_t* row) const;
+
+    //! A function variable.
+    /*!
+      A function that converts a row of the image to a stored row, leaving the padding alone.
+    */
+    void toStoredRow(const uint8_t* row, uint8_t* stored) const;
+
+private:
+    //! A function variable.
+    /*!
+      A function that parses a BMP header.
+      Return type: boolean.
+    */
+    bool parseBmp(const uint8_t* header, size_t headerSize);
+
+    //! A function variable.
+    /*!
+      A function that parses a TGA header.
+      Return type: boolean.
+    */
+    bool parseTga(const uint8_t* header, size_t headerSize);
+
+    //! A function variable.
+    /*!
+      A function that parses a PPM or PGM header.
+      Return type: boolean.
+    */
+    bool parsePpm(const uint8_t* header, size_t headerSize);
+};
+
+#endif //ImageSteganography_CARRIER_LAYOUT_H
@@ -0,0 +1,148 @@
+//!  A carrier patch class.
+/*!
+    A class that patches the stored pixel rows of BMP, TGA and PPM files with pread and pwrite.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CarrierPatch.h"
+#include "FileCommit.h"
+
+//! A function variable.
+/*!
+  A function that reads exactly size bytes at the offset, retrying short and interrupted reads.
+  Return type: boolean.
+*/
+static bool preadFully(int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while(done < size) {
+        ssize_t got = pread(fd, buffer + done, size - done, (off_t)(offset + done));
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            return false;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that writes exactly size bytes at the offset, retrying short and interrupted writes.
+  Return type: boolean.
+*/
+static bool pwriteFully(int fd, const uint8_t* buffer, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while(done < size) {
+        ssize_t put = pwrite(fd, buffer + done, size - done, (off_t)(offset + done));
+        if(put < 0 && errno == EINTR) {
+            continue;
+        }
+        if(put <= 0) {
+            return false;
+        }
+        done += (size_t)put;
+    }
+    return true;
+}
+
+//! A destructor.
+/*!
+  A destructor that closes the file.
+*/
+CarrierPatch::~CarrierPatch() {
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that opens the file and parses its header.
+  Return type: boolean.
+*/
+bool CarrierPatch::open(const char* filename) {
+    fd = ::open(filename, O_RDWR);
+    if(fd < 0) {
+        return false;
+    }
+    uint8_t header[CARRIER_HEADER_READ_SIZE];
+    ssize_t headerSize = pread(fd, header, sizeof(header), 0);
+    struct stat info;
+    if(headerSize <= 0 || fstat(fd, &info) != 0) {
+        return false;
+    }
+    return layout.parse(header, (size_t)headerSize, filename, (uint64_t)info.st_size);
+}
+
+//! A function variable.
+/*!
+  A function that reads the rows the carrier bytes reach with one pread (they are adjacent in the file
+  in either row order) and reorders rows and channels into an image.
+*/
+std::unique_ptr<Image> CarrierPatch::loadPrefix(uint64_t carrierBytes) {
+    size_t rowSize = (size_t)layout.width * layout.channels;
+    uint64_t neededRows = (carrierBytes + rowSize - 1) / rowSize;
+    int rows = (int)(neededRows < (uint64_t)layout.height ? neededRows : (uint64_t)layout.height);
+    if(rows == 0) {
+        rows = 1;
+    }
+    original.resize((size_t)rows * layout.rowStride);
+    uint64_t first = layout.bottomUp ? layout.rowOffset(rows - 1) : layout.rowOffset(0);
+    if(!preadFully(fd, original.data(), original.size(), first)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Image> prefix(new Image(layout.width, rows, layout.channels));
+    for(int y = 0; y < rows; ++y) {
+        layout.toImageRow(original.data() + (layout.rowOffset(y) - first), prefix->data + (size_t)y * rowSize);
+    }
+    bool anyAlpha = false;
+    for(size_t i = 3; layout.channels == 4 && i < prefix->size && !anyAlpha; i += 4) {
+        anyAlpha = prefix->data[i] != 0;
+    }
+    if(layout.alphaMayBeReplaced && !anyAlpha) {
+        return nullptr;
+    }
+    return prefix;
+}
+
+//! A function variable.
+/*!
+  A function that converts every row of the prefix back to the stored layout and writes the span of changed bytes,
+  then flushes the file as the sync policy asks.
+  Return type: boolean.
+*/
+bool CarrierPatch::commit(const Image& prefix, size_t& written) {
+    size_t rowSize = (size_t)layout.width * layout.channels;
+    int rows = prefix.h;
+    uint64_t first = layout.bottomUp ? layout.rowOffset(rows - 1) : layout.rowOffset(0);
+    std::vector<uint8_t> patched(rowSize);
+    written = 0;
+    for(int y = 0; y < rows; ++y) {
+        const uint8_t* stored = original.data() + (layout.rowOffset(y) - first);
+        layout.toStoredRow(prefix.data + (size_t)y * rowSize, patched.data());
+        size_t begin = 0;
+        while(begin < rowSize && patched[begin] == stored[begin]) {
+            ++begin;
+        }
+        if(begin == rowSize) {
+            continue;
+        }
+        size_t end = rowSize;
+        while(patched[end - 1] == stored[end - 1]) {
+            --end;
+        }
+        if(!pwriteFully(fd, patched.data() + begin, end - begin, layout.rowOffset(y) + begin)) {
+            return false;
+        }
+        written += end - begin;
+    }
+    return syncPatchedFile(fd);
+}
@@ -0,0 +1,71 @@
+//!  A carrier patch class.
+/*!
+  A class that edits the pixel rows of an uncompressed BMP, TGA or PPM file in place: it reads only the rows
+  the stego header and payload occupy, lets the usual kernels embed into them and writes back only the bytes that changed.
+  Rows are handed out in the order stbi_load returns them (top-down, RGB(A)), whatever the row order,
+  row padding and BGR(A) byte order of the file.
+*/
+
+#ifndef ImageSteganography_CARRIER_PATCH_H
+#define ImageSteganography_CARRIER_PATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CarrierLayout.h"
+#include "Image.h"
+
+//! A class.
+/*! A class that patches the rows of an uncompressed BMP, TGA or PPM carrier with pread and pwrite. */
+class CarrierPatch {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates a patch with no file.
+    */
+    CarrierPatch() {}
+
+    //! A destructor.
+    /*!
+      A destructor that closes the file.
+    */
+    ~CarrierPatch();
+
+    CarrierPatch(const CarrierPatch&) = delete;
+    CarrierPatch& operator=(const CarrierPatch&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that opens the file for reading and writing and parses its header.
+      It fails for the files CarrierLayout does not describe; those files are encoded by rewriting them instead.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that returns an image with the first rows of the file, enough to hold carrierBytes bytes.
+      It returns nullptr when a read fails, or when a 32-bit BMP has only zero alpha bytes in those rows:
+      stbi_load would then read the whole alpha channel as 255, which the file bytes cannot express.
+    */
+    std::unique_ptr<Image> loadPrefix(uint64_t carrierBytes);
+
+    //! A function variable.
+    /*!
+      A function that writes the rows of the prefix back to the file. Every row writes only the span
+      from its first to its last changed byte, and the number of bytes written is returned in written.
+      The file is flushed unless the sync policy is NONE.
+      Return type: boolean.
+    */
+    bool commit(const Image& prefix, size_t& written);
+
+    CarrierLayout layout; //!< A variable that stores the size and the stored pixel layout of the file.
+
+private:
+    int fd = -1; //!< A variable that stores the open file.
+    std::vector<uint8_t> original; //!< A variable that stores the stored rows as they were read.
+};
+
+#endif //ImageSteganography_CARRIER_PATCH_H
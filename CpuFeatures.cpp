@@ -0,0 +1,215 @@
+//!  A CPU features class.
+/*!
+    Functions that probe the CPU with cpuid and name the instruction sets.
+*/
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+#if defined(CPU_FEATURES_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(CPU_FEATURES_X86)
+#include <cpuid.h>
+#endif
+
+//! A structure.
+/*! A structure that stores the CPU features the kernels care about. */
+struct CpuFeatures {
+    bool sse2 = false; //!< SSE2, always present on x86-64.
+    bool ssse3 = false; //!< SSSE3 (pshufb).
+    bool avx2 = false; //!< AVX2 with the OS saving the YMM state.
+    bool bmi2 = false; //!< BMI2 (pdep/pext).
+    bool slowPdep = false; //!< AMD Zen1/Zen2, where pdep and pext are microcoded.
+    bool avx512bw = false; //!< AVX-512F and AVX-512BW with the OS saving the ZMM state.
+    bool gfni = false; //!< GFNI (Galois field affine transforms).
+};
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that runs cpuid for the leaf and subleaf and stores eax, ebx, ecx and edx in regs.
+*/
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+    int out[4];
+    __cpuidex(out, (int)leaf, (int)subleaf);
+    for(int i = 0; i < 4; ++i) {
+        regs[i] = (uint32_t)out[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+//! A function variable.
+/*!
+  A function that reads the XCR0 register, which tells which vector registers the OS saves on context switches.
+*/
+static uint64_t readXcr0() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that probes the CPU features.
+  AVX2 and AVX-512 are only reported when the OS enabled the matching XCR0 state bits.
+*/
+static CpuFeatures probeCpuFeatures() {
+    CpuFeatures features;
+#ifdef CPU_FEATURES_X86
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+    bool amd = regs[1] == 0x68747541 && regs[3] == 0x69746E65 && regs[2] == 0x444D4163; // "AuthenticAMD"
+    if(maxLeaf < 1) {
+        return features;
+    }
+
+    cpuid(1, 0, regs);
+    uint32_t family = (regs[0] >> 8) & 0xF;
+    if(family == 0xF) {
+        family += (regs[0] >> 20) & 0xFF;
+    }
+    features.slowPdep = amd && family == 0x17;
+    features.sse2 = (regs[3] >> 26) & 1;
+    features.ssse3 = (regs[2] >> 9) & 1;
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    uint64_t xcr0 = osxsave ? readXcr0() : 0;
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+    if(maxLeaf >= 7) {
+        cpuid(7, 0, regs);
+        features.avx2 = avx && ymmState && ((regs[1] >> 5) & 1);
+        features.bmi2 = (regs[1] >> 8) & 1;
+        features.avx512bw = zmmState && ((regs[1] >> 16) & 1) && ((regs[1] >> 30) & 1);
+        features.gfni = features.sse2 && ((regs[2] >> 8) & 1);
+    }
+#endif
+    return features;
+}
+
+//! A function variable.
+/*!
+  A function that returns the CPU features, probed on the first call.
+*/
+static const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = probeCpuFeatures();
+    return features;
+}
+
+//! A function variable.
+/*!
+  A function that checks whether the CPU can run the instruction set.
+  Return type: boolean.
+*/
+bool isInstructionSetSupported(InstructionSet isa) {
+    const CpuFeatures& features = cpuFeatures();
+    switch(isa) {
+        case InstructionSet::SCALAR:
+        case InstructionSet::SWAR:
+            return true;
+        case InstructionSet::SSE2:
+            return features.sse2;
+        case InstructionSet::SSSE3:
+            return features.ssse3;
+        case InstructionSet::AVX2:
+            return features.avx2;
+        case InstructionSet::BMI2:
+            return features.bmi2;
+        case InstructionSet::AVX512BW:
+            return features.avx512bw;
+    }
+    return false;
+}
+
+//! A function variable.
+/*!
+  A function that checks whether the CPU supports GFNI.
+  Return type: boolean.
+*/
+bool isGfniSupported() {
+    return cpuFeatures().gfni;
+}
+
+//! A function variable.
+/*!
+  A function that returns the fastest instruction set supported by the CPU.
+  The vector kernels handle 32 to 64 carrier bytes per instruction and win over BMI2, which handles 8.
+  BMI2 is skipped on Zen1/Zen2, where pdep and pext take tens of cycles; SWAR is the portable fallback.
+*/
+InstructionSet detectInstructionSet() {
+    const InstructionSet preference[] = {
+        InstructionSet::AVX512BW,
+        InstructionSet::AVX2,
+        InstructionSet::BMI2,
+        InstructionSet::SSSE3,
+        InstructionSet::SSE2
+    };
+    for(InstructionSet isa : preference) {
+        if(isa == InstructionSet::BMI2 && cpuFeatures().slowPdep) {
+            continue;
+        }
+        if(isInstructionSetSupported(isa)) {
+            return isa;
+        }
+    }
+    return InstructionSet::SWAR;
+}
+
+//! A function variable.
+/*!
+  A function that returns the name of the instruction set.
+*/
+const char* instructionSetName(InstructionSet isa) {
+    switch(isa) {
+        case InstructionSet::SCALAR:
+            return "scalar";
+        case InstructionSet::SWAR:
+            return "swar";
+        case InstructionSet::SSE2:
+            return "sse2";
+        case InstructionSet::SSSE3:
+            return "ssse3";
+        case InstructionSet::AVX2:
+            return "avx2";
+        case InstructionSet::BMI2:
+            return "bmi2";
+        case InstructionSet::AVX512BW:
+            return "avx512bw";
+    }
+    return "unknown";
+}
+
+//! A function variable.
+/*!
+  A function that takes the name of an instruction set and stores the matching value.
+  Return type: boolean.
+*/
+bool parseInstructionSet(const std::string& name, InstructionSet& isa) {
+    const InstructionSet all[] = {
+        InstructionSet::SCALAR,
+        InstructionSet::SWAR,
+        InstructionSet::SSE2,
+        InstructionSet::SSSE3,
+        InstructionSet::AVX2,
+        InstructionSet::BMI2,
+        InstructionSet::AVX512BW
+    };
+    for(InstructionSet candidate : all) {
+        if(name == instructionSetName(candidate)) {
+            isa = candidate;
+            return true;
+        }
+    }
+    return false;
+}
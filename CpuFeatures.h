@@ -0,0 +1,71 @@
+//!  A CPU features class.
+/*!
+  An enum with the instruction sets the stego kernels are built for and functions that probe the CPU for them.
+*/
+
+#ifndef ImageSteganography_CPU_FEATURES_H
+#define ImageSteganography_CPU_FEATURES_H
+
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_FEATURES_X86 1
+#endif
+
+#if defined(CPU_FEATURES_X86) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CPU_LITTLE_ENDIAN 1 //!< Defined when a 64-bit word loaded from memory holds its first byte in the low 8 bits.
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+//! An enum.
+/*! An enum that stores the instruction sets a kernel can be bound to. */
+enum class InstructionSet {
+    SCALAR, /*!< Enum value SCALAR, portable reference code. */
+    SWAR, /*!< Enum value SWAR, portable 64-bit code. */
+    SSE2, /*!< Enum value SSE2. */
+    SSSE3, /*!< Enum value SSSE3 (pshufb). */
+    AVX2, /*!< Enum value AVX2. */
+    BMI2, /*!< Enum value BMI2 (pdep/pext). */
+    AVX512BW /*!< Enum value AVX512BW. */
+};
+
+//! A function variable.
+/*!
+  A function that checks with cpuid (and xgetbv for the OS-managed vector state) whether the CPU can run the instruction set.
+  The probe runs once, the result is cached.
+  Return type: boolean.
+*/
+bool isInstructionSetSupported(InstructionSet isa);
+
+//! A function variable.
+/*!
+  A function that checks whether the CPU supports GFNI (gf2p8affineqb) on 128-bit vectors.
+  Return type: boolean.
+*/
+bool isGfniSupported();
+
+//! A function variable.
+/*!
+  A function that returns the fastest instruction set supported by the CPU.
+*/
+InstructionSet detectInstructionSet();
+
+//! A function variable.
+/*!
+  A function that returns the name of the instruction set, as accepted by parseInstructionSet.
+*/
+const char* instructionSetName(InstructionSet isa);
+
+//! A function variable.
+/*!
+  A function that takes the name of an instruction set (scalar, swar, sse2, ssse3, avx2, bmi2, avx512bw) and stores the matching value.
+  Return type: boolean.
+*/
+bool parseInstructionSet(const std::string& name, InstructionSet& isa);
+
+#endif //ImageSteganography_CPU_FEATURES_H
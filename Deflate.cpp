@@ -0,0 +1,722 @@
+//!  A deflate class.
+/*!
+    A class that compresses pieces of a deflate stream with hash chains, lazy matching and fixed or dynamic Huffman codes.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "CpuFeatures.h"
+#include "Deflate.h"
+
+#define DEFLATE_LAZY_LENGTH 32
+#define DEFLATE_GOOD_LENGTH 8
+#define DEFLATE_NICE_LENGTH 32
+#define DEFLATE_HASH_BYTES 4 //!< The bytes a hash covers; 3-byte matches are rarely worth their code and crowd the chains of photos.
+#define DEFLATE_STORED_BLOCK_SIZE 65535
+#define ADLER_BASE 65521
+#define ADLER_BLOCK_SIZE 5552
+
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+}; //!< The shortest match length of every length symbol (257-285).
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+}; //!< The number of extra bits of every length symbol.
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+}; //!< The shortest distance of every distance symbol.
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+}; //!< The number of extra bits of every distance symbol.
+static const uint8_t codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+}; //!< The order in which the lengths of the code length code are written.
+
+//! A structure.
+/*!
+  A structure that stores the fixed Huffman codes bit-reversed, ready to be written first bit first,
+  and the symbols of every match length and distance.
+*/
+struct FixedCodes {
+    uint16_t literalCode[288]; //!< A variable that stores the code of every literal/length symbol.
+    uint8_t literalBits[288]; //!< A variable that stores the length of every literal/length code.
+    uint16_t distanceCode[DEFLATE_DISTANCE_CODES]; //!< A variable that stores the code of every distance symbol.
+    uint8_t distanceBits[DEFLATE_DISTANCE_CODES]; //!< A variable that stores the length of every distance code, 5.
+    uint8_t lengthSymbol[DEFLATE_MAX_MATCH + 1]; //!< A variable that stores the length symbol (minus 257) of every match length.
+    uint8_t distanceSymbol[512]; //!< A variable that stores the distance symbol of distances up to 256 and of every 128 distances above.
+};
+
+//! A function variable.
+/*!
+  A function that reverses the order of the lowest count bits.
+*/
+static uint32_t reverseBits(uint32_t value, int count) {
+    uint32_t reversed = 0;
+    for(int i = 0; i < count; ++i) {
+        reversed |= ((value >> i) & 1) << (count - 1 - i);
+    }
+    return reversed;
+}
+
+//! A function variable.
+/*!
+  A function that builds the fixed codes of RFC 1951 section 3.2.6 once.
+*/
+static const FixedCodes& fixedCodes() {
+    static const FixedCodes codes = [] {
+        FixedCodes built;
+        for(int s = 0; s < 288; ++s) {
+            uint32_t code = 0;
+            int count = 0;
+            if(s < 144) {
+                code = 0x30 + s;
+                count = 8;
+            }
+            else if(s < 256) {
+                code = 0x190 + (s - 144);
+                count = 9;
+            }
+            else if(s < 280) {
+                code = s - 256;
+                count = 7;
+            }
+            else {
+                code = 0xC0 + (s - 280);
+                count = 8;
+            }
+            built.literalCode[s] = (uint16_t)reverseBits(code, count);
+            built.literalBits[s] = (uint8_t)count;
+        }
+        for(int s = 0; s < 30; ++s) {
+            built.distanceCode[s] = (uint16_t)reverseBits((uint32_t)s, 5);
+            built.distanceBits[s] = 5;
+        }
+        for(int s = 0; s < 29; ++s) {
+            int next = s == 28 ? DEFLATE_MAX_MATCH + 1 : lengthBase[s + 1];
+            for(int length = lengthBase[s]; length < next && length <= DEFLATE_MAX_MATCH; ++length) {
+                built.lengthSymbol[length] = (uint8_t)s;
+            }
+        }
+        built.lengthSymbol[DEFLATE_MAX_MATCH] = 28;
+        for(int s = 0; s < 30; ++s) {
+            int next = s == 29 ? DEFLATE_WINDOW_SIZE + 1 : distanceBase[s + 1];
+            for(int distance = distanceBase[s]; distance < next; ++distance) {
+                int index = distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7);
+                built.distanceSymbol[index] = (uint8_t)s;
+            }
+        }
+        return built;
+    }();
+    return codes;
+}
+
+//! A function variable.
+/*!
+  A function that turns weights sorted in increasing order into the code lengths of a minimum redundancy code, in place
+  (Moffat and Katajainen): the first pass builds the tree in the array, the second counts the depth of every leaf.
+*/
+static void minimumRedundancy(uint32_t* weights, int n) {
+    weights[0] += weights[1];
+    int root = 0;
+    int leaf = 2;
+    for(int next = 1; next < n - 1; ++next) {
+        if(leaf >= n || weights[root] < weights[leaf]) {
+            weights[next] = weights[root];
+            weights[root++] = (uint32_t)next;
+        }
+        else {
+            weights[next] = weights[leaf++];
+        }
+        if(leaf >= n || (root < next && weights[root] < weights[leaf])) {
+            weights[next] += weights[root];
+            weights[root++] = (uint32_t)next;
+        }
+        else {
+            weights[next] += weights[leaf++];
+        }
+    }
+    weights[n - 2] = 0;
+    for(int next = n - 3; next >= 0; --next) {
+        weights[next] = weights[weights[next]] + 1;
+    }
+    int available = 1;
+    int used = 0;
+    uint32_t depth = 0;
+    int root2 = n - 2;
+    int next = n - 1;
+    while(available > 0) {
+        while(root2 >= 0 && weights[root2] == depth) {
+            ++used;
+            --root2;
+        }
+        while(available > used) {
+            weights[next--] = depth;
+            --available;
+        }
+        available = 2 * used;
+        ++depth;
+        used = 0;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that builds the code lengths of the symbols from their counts, at most maxBits long. At least two symbols
+  get a code, as inflaters expect of a complete code. Lengths over the limit are cut to it and the code is made
+  complete again by lengthening the deepest shorter codes, as miniz does; unused symbols get length 0.
+*/
+static void buildLengths(const uint32_t* counts, int symbols, int maxBits, uint8_t* lengths) {
+    int sorted[DEFLATE_LITERAL_CODES];
+    uint32_t weights[DEFLATE_LITERAL_CODES];
+    int used = 0;
+    for(int s = 0; s < symbols; ++s) {
+        lengths[s] = 0;
+        if(counts[s] > 0) {
+            sorted[used++] = s;
+        }
+    }
+    for(int s = 0; used < 2; ++s) {
+        if(counts[s] == 0) {
+            sorted[used++] = s;
+        }
+    }
+    std::sort(sorted, sorted + used, [counts](int a, int b) {
+        return counts[a] < counts[b] || (counts[a] == counts[b] && a < b);
+    });
+    for(int i = 0; i < used; ++i) {
+        weights[i] = counts[sorted[i]];
+    }
+    minimumRedundancy(weights, used);
+
+    int lengthCounts[16] = {0};
+    for(int i = 0; i < used; ++i) {
+        ++lengthCounts[std::min<uint32_t>(weights[i], (uint32_t)maxBits)];
+    }
+    uint32_t total = 0;
+    for(int bits = 1; bits <= maxBits; ++bits) {
+        total += (uint32_t)lengthCounts[bits] << (maxBits - bits);
+    }
+    while(total > (1u << maxBits)) {
+        --lengthCounts[maxBits];
+        for(int bits = maxBits - 1; bits > 0; --bits) {
+            if(lengthCounts[bits] > 0) {
+                --lengthCounts[bits];
+                lengthCounts[bits + 1] += 2;
+                break;
+            }
+        }
+        --total;
+    }
+    int next = 0;
+    for(int bits = maxBits; bits > 0; --bits) {
+        for(int k = lengthCounts[bits]; k > 0; --k) {
+            lengths[sorted[next++]] = (uint8_t)bits;
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that assigns the canonical codes of RFC 1951 section 3.2.2 to the lengths, bit-reversed.
+*/
+static void buildCodes(const uint8_t* lengths, int symbols, uint16_t* codes) {
+    uint32_t lengthCounts[16] = {0};
+    for(int s = 0; s < symbols; ++s) {
+        ++lengthCounts[lengths[s]];
+    }
+    lengthCounts[0] = 0;
+    uint32_t next[16];
+    uint32_t code = 0;
+    for(int bits = 1; bits < 16; ++bits) {
+        code = (code + lengthCounts[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for(int s = 0; s < symbols; ++s) {
+        codes[s] = lengths[s] > 0 ? (uint16_t)reverseBits(next[lengths[s]]++, lengths[s]) : 0;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that run-length codes the code lengths with the symbols 16 (repeat the previous length 3-6 times),
+  17 (3-10 zeros) and 18 (11-138 zeros). Every run is stored as its symbol with the repeat count in the bits above 5.
+  Return type: the number of runs.
+*/
+static int runLengths(const uint8_t* lengths, int count, uint16_t* runs) {
+    int runCount = 0;
+    int i = 0;
+    while(i < count) {
+        uint8_t value = lengths[i];
+        int run = 1;
+        while(i + run < count && lengths[i + run] == value) {
+            ++run;
+        }
+        i += run;
+        if(value == 0) {
+            while(run >= 11) {
+                int repeat = std::min(run, 138);
+                runs[runCount++] = (uint16_t)(18 | ((repeat - 11) << 5));
+                run -= repeat;
+            }
+            if(run >= 3) {
+                runs[runCount++] = (uint16_t)(17 | ((run - 3) << 5));
+                run = 0;
+            }
+        }
+        else {
+            runs[runCount++] = value;
+            --run;
+            while(run >= 3) {
+                int repeat = std::min(run, 6);
+                runs[runCount++] = (uint16_t)(16 | ((repeat - 3) << 5));
+                run -= repeat;
+            }
+        }
+        while(run-- > 0) {
+            runs[runCount++] = value;
+        }
+    }
+    return runCount;
+}
+
+//! A function variable.
+/*!
+  A function that returns the distance symbol of a distance.
+*/
+static inline int distanceSymbolOf(const FixedCodes& codes, uint32_t distance) {
+    return distance <= 256 ? codes.distanceSymbol[distance - 1] : codes.distanceSymbol[256 + ((distance - 1) >> 7)];
+}
+
+//! A function variable.
+/*!
+  A function that hashes the DEFLATE_HASH_BYTES bytes at the position.
+*/
+static inline uint32_t hashBytes(const uint8_t* bytes) {
+    uint32_t value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+//! A constructor.
+/*!
+  A constructor that allocates the hash heads and the chain links of the window.
+*/
+Deflater::Deflater(int matchDepth)
+    : matchDepth(matchDepth < 1 ? 1 : matchDepth),
+      goodDepth(std::max(1, this->matchDepth / 4)),
+      niceLength(std::min(DEFLATE_MAX_MATCH, std::max(DEFLATE_NICE_LENGTH, this->matchDepth * 8))),
+      head(new int32_t[1 << DEFLATE_HASH_BITS]),
+      previous(new int32_t[DEFLATE_WINDOW_SIZE]) {
+    tokens.reserve(DEFLATE_BLOCK_TOKENS);
+    std::fill(literalCounts, literalCounts + DEFLATE_LITERAL_CODES, 0);
+    std::fill(distanceCounts, distanceCounts + DEFLATE_DISTANCE_CODES, 0);
+}
+
+//! A function variable.
+/*!
+  A function that links the position to the previous one with the same hash and makes it the head of its chain.
+*/
+inline void Deflater::insert(uint32_t p, uint32_t hash) {
+    previous[p & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+    head[hash] = (int32_t)p;
+}
+
+//! A function variable.
+/*!
+  A function that walks the chain of the position, newest first, for at most depth entries within the window.
+  A candidate is only compared in full when its first two bytes match and so do the two bytes that end a match
+  longer than the best one so far; the comparison itself runs 8 bytes at a time on little-endian targets.
+*/
+int Deflater::findMatch(const uint8_t* base, uint32_t p, uint32_t end, uint32_t hash, int longerThan, int depth, uint32_t& distance) const {
+    int maxLength = (int)std::min<uint32_t>(DEFLATE_MAX_MATCH, end - p);
+    int best = std::max(longerThan, DEFLATE_MIN_MATCH - 1);
+    if(best >= maxLength) {
+        return 0;
+    }
+    const uint8_t* current = base + p;
+    uint32_t limit = p > DEFLATE_WINDOW_SIZE ? p - DEFLATE_WINDOW_SIZE : 0;
+    int32_t candidate = head[hash];
+    int bestLength = 0;
+    uint16_t start = 0;
+    uint16_t tail = 0;
+    memcpy(&start, current, 2);
+    memcpy(&tail, current + best - 1, 2);
+    for(int chain = depth; candidate >= 0 && (uint32_t)candidate >= limit && chain > 0; --chain) {
+        const uint8_t* earlier = base + candidate;
+        uint16_t earlierStart = 0;
+        uint16_t earlierTail = 0;
+        memcpy(&earlierStart, earlier, 2);
+        memcpy(&earlierTail, earlier + best - 1, 2);
+        if(earlierTail == tail && earlierStart == start) {
+            int length = 2;
+#if defined(CPU_LITTLE_ENDIAN) && (defined(__GNUC__) || defined(__clang__))
+            while(length + 8 <= maxLength) {
+                uint64_t a = 0;
+                uint64_t b = 0;
+                memcpy(&a, earlier + length, 8);
+                memcpy(&b, current + length, 8);
+                if(a != b) {
+                    length += __builtin_ctzll(a ^ b) >> 3;
+                    break;
+                }
+                length += 8;
+            }
+            if(length + 8 > maxLength) {
+                while(length < maxLength && earlier[length] == current[length]) {
+                    ++length;
+                }
+            }
+#else
+            while(length < maxLength && earlier[length] == current[length]) {
+                ++length;
+            }
+#endif
+            if(length > best) {
+                best = length;
+                bestLength = length;
+                distance = p - (uint32_t)candidate;
+                if(length >= niceLength || length >= maxLength) {
+                    break;
+                }
+                memcpy(&tail, current + best - 1, 2);
+            }
+        }
+        int32_t next = previous[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+        if(next >= candidate) {
+            break;
+        }
+        candidate = next;
+    }
+    return bestLength;
+}
+
+//! A function variable.
+/*!
+  A function that appends the bits to the bit buffer and moves 32 of them to the output when they are complete.
+  Calls add at most 31 bits, so the buffer never overflows.
+*/
+inline void Deflater::putBits(uint32_t value, int count) {
+    bits |= (uint64_t)value << bitCount;
+    bitCount += count;
+    if(bitCount >= 32) {
+        output[0] = (uint8_t)bits;
+        output[1] = (uint8_t)(bits >> 8);
+        output[2] = (uint8_t)(bits >> 16);
+        output[3] = (uint8_t)(bits >> 24);
+        output += 4;
+        bits >>= 32;
+        bitCount -= 32;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that stores the literal and counts its symbol.
+*/
+inline void Deflater::addLiteral(uint8_t value) {
+    tokens.push_back(value);
+    ++literalCounts[value];
+}
+
+//! A function variable.
+/*!
+  A function that stores the match and counts its length and distance symbols.
+*/
+inline void Deflater::addMatch(int length, uint32_t distance) {
+    const FixedCodes& codes = fixedCodes();
+    tokens.push_back((uint32_t)length | (distance << 16));
+    ++literalCounts[257 + codes.lengthSymbol[length]];
+    ++distanceCounts[distanceSymbolOf(codes, distance)];
+}
+
+//! A function variable.
+/*!
+  A function that writes every literal as its code, and every match as its length symbol with the extra bits,
+  then its distance symbol with the extra bits.
+*/
+void Deflater::putTokens(const uint16_t* literalCode, const uint8_t* literalBits, const uint16_t* distanceCode, const uint8_t* distanceBits) {
+    const FixedCodes& codes = fixedCodes();
+    for(uint32_t token : tokens) {
+        uint32_t distance = token >> 16;
+        uint32_t value = token & 0xFFFF;
+        if(distance == 0) {
+            putBits(literalCode[value], literalBits[value]);
+            continue;
+        }
+        int symbol = codes.lengthSymbol[value];
+        int count = literalBits[257 + symbol];
+        putBits(literalCode[257 + symbol] | ((value - lengthBase[symbol]) << count), count + lengthExtra[symbol]);
+        int distanceSymbol = distanceSymbolOf(codes, distance);
+        count = distanceBits[distanceSymbol];
+        putBits(distanceCode[distanceSymbol] | ((distance - distanceBase[distanceSymbol]) << count), count + distanceExtra[distanceSymbol]);
+    }
+    putBits(literalCode[256], literalBits[256]);
+}
+
+//! A function variable.
+/*!
+  A function that builds the Huffman codes of the block and its code length code, counts the bits the block takes
+  with them, with the fixed codes and stored, and writes the smallest. The extra bits of the matches cost the same
+  with both codes.
+*/
+void Deflater::putBlock(const uint8_t* data, size_t size, bool last) {
+    const FixedCodes& codes = fixedCodes();
+    literalCounts[256] = 1;
+    uint8_t literalBits[DEFLATE_LITERAL_CODES];
+    uint8_t distanceBits[DEFLATE_DISTANCE_CODES];
+    buildLengths(literalCounts, DEFLATE_LITERAL_CODES, 15, literalBits);
+    buildLengths(distanceCounts, DEFLATE_DISTANCE_CODES, 15, distanceBits);
+    int literalCodes = DEFLATE_LITERAL_CODES;
+    while(literalCodes > 257 && literalBits[literalCodes - 1] == 0) {
+        --literalCodes;
+    }
+    int distanceCodes = DEFLATE_DISTANCE_CODES;
+    while(distanceCodes > 1 && distanceBits[distanceCodes - 1] == 0) {
+        --distanceCodes;
+    }
+    uint8_t lengths[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+    std::copy(literalBits, literalBits + literalCodes, lengths);
+    std::copy(distanceBits, distanceBits + distanceCodes, lengths + literalCodes);
+    uint16_t runs[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+    int runCount = runLengths(lengths, literalCodes + distanceCodes, runs);
+    uint32_t lengthCounts[19] = {0};
+    for(int i = 0; i < runCount; ++i) {
+        ++lengthCounts[runs[i] & 31];
+    }
+    uint8_t lengthBits[19];
+    buildLengths(lengthCounts, 19, 7, lengthBits);
+    int orderedCodes = 19;
+    while(orderedCodes > 4 && lengthBits[codeLengthOrder[orderedCodes - 1]] == 0) {
+        --orderedCodes;
+    }
+
+    uint64_t extraBits = 0;
+    uint64_t dynamicBits = 17 + 3 * (uint64_t)orderedCodes + 2 * lengthCounts[16] + 3 * lengthCounts[17] + 7 * lengthCounts[18];
+    uint64_t fixedBits = 3;
+    for(int s = 0; s < 19; ++s) {
+        dynamicBits += (uint64_t)lengthCounts[s] * lengthBits[s];
+    }
+    for(int s = 0; s < DEFLATE_LITERAL_CODES; ++s) {
+        dynamicBits += (uint64_t)literalCounts[s] * literalBits[s];
+        fixedBits += (uint64_t)literalCounts[s] * codes.literalBits[s];
+        if(s > 256) {
+            extraBits += (uint64_t)literalCounts[s] * lengthExtra[s - 257];
+        }
+    }
+    for(int s = 0; s < DEFLATE_DISTANCE_CODES; ++s) {
+        dynamicBits += (uint64_t)distanceCounts[s] * distanceBits[s];
+        fixedBits += (uint64_t)distanceCounts[s] * 5;
+        extraBits += (uint64_t)distanceCounts[s] * distanceExtra[s];
+    }
+    dynamicBits += extraBits;
+    fixedBits += extraBits;
+    uint64_t storedBits = (3 + 7 + 32) * (uint64_t)(size / DEFLATE_STORED_BLOCK_SIZE + 1) + 8 * (uint64_t)size;
+
+    if(storedBits < std::min(dynamicBits, fixedBits)) {
+        putStored(data, size, last);
+    }
+    else if(dynamicBits < fixedBits) {
+        uint16_t literalCode[DEFLATE_LITERAL_CODES];
+        uint16_t distanceCode[DEFLATE_DISTANCE_CODES];
+        uint16_t lengthCode[19];
+        buildCodes(literalBits, DEFLATE_LITERAL_CODES, literalCode);
+        buildCodes(distanceBits, DEFLATE_DISTANCE_CODES, distanceCode);
+        buildCodes(lengthBits, 19, lengthCode);
+        putBits(last ? 1 : 0, 1);
+        putBits(2, 2);
+        putBits((uint32_t)(literalCodes - 257), 5);
+        putBits((uint32_t)(distanceCodes - 1), 5);
+        putBits((uint32_t)(orderedCodes - 4), 4);
+        for(int i = 0; i < orderedCodes; ++i) {
+            putBits(lengthBits[codeLengthOrder[i]], 3);
+        }
+        static const int repeatBits[3] = {2, 3, 7};
+        for(int i = 0; i < runCount; ++i) {
+            int symbol = runs[i] & 31;
+            putBits(lengthCode[symbol], lengthBits[symbol]);
+            if(symbol >= 16) {
+                putBits((uint32_t)(runs[i] >> 5), repeatBits[symbol - 16]);
+            }
+        }
+        putTokens(literalCode, literalBits, distanceCode, distanceBits);
+    }
+    else {
+        putBits(last ? 1 : 0, 1);
+        putBits(1, 2);
+        putTokens(codes.literalCode, codes.literalBits, codes.distanceCode, codes.distanceBits);
+    }
+
+    tokens.clear();
+    std::fill(literalCounts, literalCounts + DEFLATE_LITERAL_CODES, 0);
+    std::fill(distanceCounts, distanceCounts + DEFLATE_DISTANCE_CODES, 0);
+}
+
+//! A function variable.
+/*!
+  A function that writes the buffered bits and pads the last byte with zero bits.
+*/
+void Deflater::alignBits() {
+    while(bitCount > 0) {
+        *output++ = (uint8_t)bits;
+        bits >>= 8;
+        bitCount -= 8;
+    }
+    bits = 0;
+    bitCount = 0;
+}
+
+//! A function variable.
+/*!
+  A function that writes the bytes as uncompressed blocks of up to 65535 bytes, each starting on a byte boundary.
+*/
+void Deflater::putStored(const uint8_t* data, size_t size, bool last) {
+    size_t done = 0;
+    do {
+        size_t count = std::min<size_t>(DEFLATE_STORED_BLOCK_SIZE, size - done);
+        putBits(last && done + count == size ? 1 : 0, 1);
+        putBits(0, 2);
+        alignBits();
+        output[0] = (uint8_t)count;
+        output[1] = (uint8_t)(count >> 8);
+        output[2] = (uint8_t)~count;
+        output[3] = (uint8_t)(~count >> 8);
+        if(count > 0) {
+            memcpy(output + 4, data + done, count);
+        }
+        output += 4 + count;
+        done += count;
+    } while(done < size);
+}
+
+//! A function variable.
+/*!
+  A function that links the dictionary into the hash chains, then collects the literals and matches of the piece
+  and writes them every DEFLATE_BLOCK_TOKENS as a block. A match found at a position is held back for one position:
+  if the next position has a longer match the held one becomes a literal (lazy matching). A block never takes more
+  than the bytes it covers stored, so the output is bounded by the size of the piece plus the block headers.
+*/
+void Deflater::compress(const uint8_t* data, size_t dictionarySize, size_t size, bool last, std::vector<uint8_t>& out) {
+    dictionarySize = std::min<size_t>(dictionarySize, DEFLATE_WINDOW_SIZE);
+    const uint8_t* base = data - dictionarySize;
+    uint32_t begin = (uint32_t)dictionarySize;
+    uint32_t end = (uint32_t)(dictionarySize + size);
+    size_t start = out.size();
+    out.resize(start + size + size / 64 + 64);
+    output = out.data() + start;
+    bits = 0;
+    bitCount = 0;
+
+    std::fill(head.get(), head.get() + (1 << DEFLATE_HASH_BITS), -1);
+    for(uint32_t p = 0; p < begin && p + DEFLATE_HASH_BYTES <= end; ++p) {
+        insert(p, hashBytes(base + p));
+    }
+
+    uint32_t blockBegin = begin;
+    uint32_t p = begin;
+    int heldLength = 0;
+    uint32_t heldDistance = 0;
+    bool held = false;
+    while(p < end) {
+        if(tokens.size() >= DEFLATE_BLOCK_TOKENS) {
+            uint32_t blockEnd = held ? p - 1 : p;
+            putBlock(base + blockBegin, blockEnd - blockBegin, false);
+            blockBegin = blockEnd;
+        }
+        int length = 0;
+        uint32_t distance = 0;
+        if(p + DEFLATE_HASH_BYTES <= end) {
+            uint32_t hash = hashBytes(base + p);
+            if(!held || heldLength < DEFLATE_LAZY_LENGTH) {
+                int depth = held && heldLength >= DEFLATE_GOOD_LENGTH ? goodDepth : matchDepth;
+                length = findMatch(base, p, end, hash, held ? heldLength : 0, depth, distance);
+            }
+            insert(p, hash);
+        }
+        if(held) {
+            if(heldLength >= DEFLATE_MIN_MATCH && length == 0) {
+                addMatch(heldLength, heldDistance);
+                uint32_t matchEnd = p - 1 + (uint32_t)heldLength;
+                for(uint32_t q = p + 1; q < matchEnd && q + DEFLATE_HASH_BYTES <= end; ++q) {
+                    insert(q, hashBytes(base + q));
+                }
+                p = matchEnd;
+                held = false;
+                continue;
+            }
+            addLiteral(base[p - 1]);
+        }
+        held = true;
+        heldLength = length;
+        heldDistance = distance;
+        ++p;
+    }
+    if(held) {
+        addLiteral(base[p - 1]);
+    }
+    putBlock(base + blockBegin, end - blockBegin, last);
+    if(!last) {
+        putStored(nullptr, 0, false);
+    }
+    alignBits();
+    out.resize((size_t)(output - out.data()));
+}
+
+//! A function variable.
+/*!
+  A function that keeps one deflater per thread and replaces it when another match depth is asked for.
+*/
+Deflater& threadDeflater(int matchDepth) {
+    thread_local std::unique_ptr<Deflater> deflater;
+    if(!deflater || deflater->depth() != std::max(1, matchDepth)) {
+        deflater.reset(new Deflater(matchDepth));
+    }
+    return *deflater;
+}
+
+//! A function variable.
+/*!
+  A function that updates the checksum in blocks of 5552 bytes, the most that cannot overflow the sums before the modulo.
+*/
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while(size > 0) {
+        size_t count = std::min<size_t>(size, ADLER_BLOCK_SIZE);
+        for(size_t i = 0; i < count; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+        data += count;
+        size -= count;
+    }
+    return (b << 16) | a;
+}
+
+//! A function variable.
+/*!
+  A function that combines the checksums: the first sum of the whole is the sum of both first sums minus the 1 counted twice,
+  and the second sum adds the first sum of the first piece once for every byte of the second piece.
+*/
+uint32_t adler32Combine(uint32_t first, uint32_t second, uint64_t secondSize) {
+    uint32_t remainder = (uint32_t)(secondSize % ADLER_BASE);
+    uint32_t a = first & 0xFFFF;
+    uint32_t b = (uint32_t)(((uint64_t)remainder * a) % ADLER_BASE);
+    a += (second & 0xFFFF) + ADLER_BASE - 1;
+    b += (first >> 16) + (second >> 16) + ADLER_BASE - remainder;
+    if(a >= ADLER_BASE) {
+        a -= ADLER_BASE;
+    }
+    if(a >= ADLER_BASE) {
+        a -= ADLER_BASE;
+    }
+    if(b >= 2 * ADLER_BASE) {
+        b -= 2 * ADLER_BASE;
+    }
+    if(b >= ADLER_BASE) {
+        b -= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
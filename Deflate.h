@@ -0,0 +1,145 @@
+//!  A deflate class.
+/*!
+  A class that compresses independent pieces of one deflate stream (RFC 1951), so the pieces of a large buffer can be
+  compressed on different threads and concatenated, as pigz does. Every piece may start with a preset dictionary
+  (the 32 KB before it) and ends on a byte boundary: with a sync flush (an empty stored block) or with the final block.
+  Matches are found with hash chains over 4-byte hashes and lazy matching. Every block of DEFLATE_BLOCK_TOKENS literals and matches is written
+  with Huffman codes built for it, with the fixed codes or stored, whichever is the smallest.
+*/
+
+#ifndef ImageSteganography_DEFLATE_H
+#define ImageSteganography_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_BLOCK_TOKENS 16384
+#define DEFLATE_LITERAL_CODES 286
+#define DEFLATE_DISTANCE_CODES 30
+
+//! A class.
+/*! A class that deflates pieces of a stream with a bounded hash-chain match search. */
+class Deflater {
+public:
+    //! A constructor.
+    /*!
+      A constructor that takes how many earlier positions with the same hash are compared at most for every match.
+    */
+    explicit Deflater(int matchDepth);
+
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that compresses size bytes at data and appends them to out. The dictionarySize bytes before data
+      are the end of the previous piece and can be referred to by matches. The last piece ends with the final block,
+      the others with a sync flush. Pieces that do not compress are stored.
+    */
+    void compress(const uint8_t* data, size_t dictionarySize, size_t size, bool last, std::vector<uint8_t>& out);
+
+    //! A function variable.
+    /*!
+      A function that returns how many chain entries a match search compares.
+    */
+    int depth() const { return matchDepth; }
+
+private:
+    //! A function variable.
+    /*!
+      A function that adds position p of the buffer, whose bytes have the given hash, to the hash chains.
+    */
+    void insert(uint32_t p, uint32_t hash);
+
+    //! A function variable.
+    /*!
+      A function that finds the longest match for position p, whose bytes have the given hash, within the window,
+      longer than the given length and comparing at most depth chain entries, and returns its length (0 if none
+      was found) and its distance.
+    */
+    int findMatch(const uint8_t* base, uint32_t p, uint32_t end, uint32_t hash, int longerThan, int depth, uint32_t& distance) const;
+
+    //! A function variable.
+    /*!
+      A function that appends count bits of value to the output, the first bit in bit 0.
+    */
+    void putBits(uint32_t value, int count);
+
+    //! A function variable.
+    /*!
+      A function that adds a literal to the block.
+    */
+    void addLiteral(uint8_t value);
+
+    //! A function variable.
+    /*!
+      A function that adds a match to the block.
+    */
+    void addMatch(int length, uint32_t distance);
+
+    //! A function variable.
+    /*!
+      A function that writes the literals and matches of the block with the given codes, then the end of block code.
+    */
+    void putTokens(const uint16_t* literalCode, const uint8_t* literalBits, const uint16_t* distanceCode, const uint8_t* distanceBits);
+
+    //! A function variable.
+    /*!
+      A function that writes the block, whose literals and matches cover the size bytes at data, in the smallest
+      of its three forms and starts the next one.
+    */
+    void putBlock(const uint8_t* data, size_t size, bool last);
+
+    //! A function variable.
+    /*!
+      A function that writes the buffered bits to the output, padded with zero bits to a byte boundary.
+    */
+    void alignBits();
+
+    //! A function variable.
+    /*!
+      A function that writes the bytes as uncompressed blocks.
+    */
+    void putStored(const uint8_t* data, size_t size, bool last);
+
+    int matchDepth; //!< A variable that stores how many chain entries a match search compares.
+    int goodDepth; //!< A variable that stores how many chain entries are compared when the held match is already good.
+    int niceLength; //!< A variable that stores the match length that ends a search.
+    std::unique_ptr<int32_t[]> head; //!< A variable that stores the last position of every hash, -1 for none.
+    std::unique_ptr<int32_t[]> previous; //!< A variable that stores, for every position of the window, the previous position with the same hash.
+    std::vector<uint32_t> tokens; //!< A variable that stores the literals and matches of the block, the distance (0 for a literal) in the high 16 bits.
+    uint32_t literalCounts[DEFLATE_LITERAL_CODES]; //!< A variable that stores how often the block uses every literal/length symbol.
+    uint32_t distanceCounts[DEFLATE_DISTANCE_CODES]; //!< A variable that stores how often the block uses every distance symbol.
+    uint8_t* output = nullptr; //!< A variable that stores where the next byte is written.
+    uint64_t bits = 0; //!< A variable that stores the bits not written yet, the first one in bit 0.
+    int bitCount = 0; //!< A variable that stores how many bits are buffered.
+};
+
+//! A function variable.
+/*!
+  A function that returns the deflater of the calling thread for the match depth. It is created on first use and kept,
+  so the hash tables and the block buffer are allocated once per thread, not once per piece.
+*/
+Deflater& threadDeflater(int matchDepth);
+
+//! A function variable.
+/*!
+  A function that updates the Adler-32 checksum of a zlib stream with size bytes of uncompressed data.
+  The checksum of no data is 1.
+*/
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+//! A function variable.
+/*!
+  A function that returns the Adler-32 checksum of two pieces of data from the checksums of both pieces
+  and the size of the second one, as zlib's adler32_combine does.
+*/
+uint32_t adler32Combine(uint32_t first, uint32_t second, uint64_t secondSize);
+
+#endif //ImageSteganography_DEFLATE_H
@@ -0,0 +1,287 @@
+//!  A file commit module.
+/*!
+    Functions that write a new file next to the old one and rename it over the old one.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FileCommit.h"
+
+#define FILE_COMMIT_LINK_ATTEMPTS 100
+#define FILE_COMMIT_COPY_SIZE 65536 //!< The bytes copied at once when an unnamed file cannot be linked.
+
+static SyncPolicy configuredPolicy = SyncPolicy::FILE; //!< The sync policy set with setSyncPolicy.
+
+//! A function variable.
+/*!
+  A function that returns the name of the sync policy.
+*/
+const char* syncPolicyName(SyncPolicy policy) {
+    switch(policy) {
+        case SyncPolicy::NONE:
+            return "none";
+        case SyncPolicy::FILE:
+            return "file";
+        case SyncPolicy::DIRECTORY:
+            return "dir";
+    }
+    return "unknown";
+}
+
+//! A function variable.
+/*!
+  A function that takes the name of a sync policy and stores the matching value.
+  Return type: boolean.
+*/
+bool parseSyncPolicy(const std::string& name, SyncPolicy& policy) {
+    const SyncPolicy all[] = {SyncPolicy::NONE, SyncPolicy::FILE, SyncPolicy::DIRECTORY};
+    for(SyncPolicy candidate : all) {
+        if(name == syncPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+//! A function variable.
+/*!
+  A function that returns the sync policy files are written with.
+*/
+SyncPolicy syncPolicy() {
+    return configuredPolicy;
+}
+
+//! A function variable.
+/*!
+  A function that sets the sync policy files are written with.
+*/
+void setSyncPolicy(SyncPolicy policy) {
+    configuredPolicy = policy;
+}
+
+//! A function variable.
+/*!
+  A function that returns the directory of the file, "." for a bare file name.
+*/
+static std::string directoryOf(const char* filename) {
+    const char* slash = strrchr(filename, '/');
+    if(slash == nullptr) {
+        return ".";
+    }
+    if(slash == filename) {
+        return "/";
+    }
+    return std::string(filename, slash - filename);
+}
+
+//! A function variable.
+/*!
+  A function that writes exactly size bytes, retrying short and interrupted writes.
+  Return type: boolean.
+*/
+static bool writeFully(int fd, const uint8_t* data, size_t size) {
+    size_t done = 0;
+    while(done < size) {
+        ssize_t put = write(fd, data + done, size - done);
+        if(put < 0 && errno == EINTR) {
+            continue;
+        }
+        if(put <= 0) {
+            return false;
+        }
+        done += (size_t)put;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that gives the unnamed O_TMPFILE file a temporary name next to the file it replaces,
+  since linkat cannot replace an existing file.
+  Return type: boolean.
+*/
+static bool linkTemporary(int fd, const char* filename, std::string& temporaryName) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    for(int attempt = 0; attempt < FILE_COMMIT_LINK_ATTEMPTS; ++attempt) {
+        temporaryName = std::string(filename) + ".tmp" + std::to_string(getpid()) + "." + std::to_string(attempt);
+        if(linkat(AT_FDCWD, path, AT_FDCWD, temporaryName.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+            return true;
+        }
+        if(errno != EEXIST) {
+            break;
+        }
+    }
+    temporaryName.clear();
+    return false;
+}
+
+//! A function variable.
+/*!
+  A function that copies the size bytes of the unnamed file to a new mkstemp file next to the file it replaces,
+  with the same permissions, for when linkTemporary fails (linkat refused with EPERM, /proc unmounted since open).
+  Return type: boolean.
+*/
+static bool copyTemporary(int fd, uint64_t size, const char* filename, std::string& temporaryName) {
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        return false;
+    }
+    temporaryName = std::string(filename) + ".XXXXXX";
+    int copy = mkstemp(&temporaryName[0]);
+    if(copy < 0) {
+        temporaryName.clear();
+        return false;
+    }
+    bool success = fchmod(copy, info.st_mode & 07777) == 0;
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[FILE_COMMIT_COPY_SIZE]);
+    for(uint64_t done = 0; success && done < size;) {
+        ssize_t got = pread(fd, buffer.get(), (size_t)std::min<uint64_t>(FILE_COMMIT_COPY_SIZE, size - done), (off_t)done);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        success = got > 0 && writeFully(copy, buffer.get(), (size_t)got);
+        done += success ? (uint64_t)got : 0;
+    }
+    success = success && (configuredPolicy == SyncPolicy::NONE || fsync(copy) == 0);
+    if(close(copy) != 0) {
+        success = false;
+    }
+    if(!success) {
+        unlink(temporaryName.c_str());
+        temporaryName.clear();
+    }
+    return success;
+}
+
+//! A destructor.
+/*!
+  A destructor that closes and removes the new file unless it was committed.
+*/
+FileReplacement::~FileReplacement() {
+    if(fd >= 0) {
+        close(fd);
+    }
+    if(!temporaryName.empty()) {
+        unlink(temporaryName.c_str());
+    }
+}
+
+//! A function variable.
+/*!
+  A function that creates the new file with the permissions of the file it replaces (or the umask for a new file).
+  The anonymous variant creates it with O_TMPFILE, so nothing is left behind if the process dies before the commit;
+  it needs /proc to be linked later, and is opened for reading too so commit can copy it when linking fails.
+  The other one creates it with mkstemp.
+  Return type: boolean.
+*/
+bool FileReplacement::open(const char* filename) {
+    this->filename = filename;
+    directory = directoryOf(filename);
+    struct stat original;
+    mode_t mode = 0;
+    if(stat(filename, &original) == 0) {
+        mode = original.st_mode & 07777;
+    }
+    else {
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+#ifdef O_TMPFILE
+    if(access("/proc/self/fd", X_OK) == 0) {
+        fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    }
+#endif
+    if(fd < 0) {
+        temporaryName = std::string(filename) + ".XXXXXX";
+        fd = mkstemp(&temporaryName[0]);
+        if(fd < 0) {
+            temporaryName.clear();
+            return false;
+        }
+    }
+    failed = fchmod(fd, mode) != 0;
+    return !failed;
+}
+
+//! A function variable.
+/*!
+  A function that appends data to the new file.
+  Return type: boolean.
+*/
+bool FileReplacement::write(const uint8_t* data, size_t size) {
+    failed = failed || fd < 0 || !writeFully(fd, data, size);
+    written += failed ? 0 : size;
+    return !failed;
+}
+
+//! A function variable.
+/*!
+  A function that returns how many bytes were written to the new file.
+*/
+uint64_t FileReplacement::size() const {
+    return written;
+}
+
+//! A function variable.
+/*!
+  A function that flushes the new file as the policy asks, names it, renames it over the file and, with the DIRECTORY
+  policy, flushes the directory so the rename itself survives a power failure. An unnamed file that cannot be linked
+  is copied to a mkstemp file, which is renamed instead.
+  Return type: boolean.
+*/
+bool FileReplacement::commit() {
+    if(failed || fd < 0) {
+        return false;
+    }
+    bool success = configuredPolicy == SyncPolicy::NONE || fsync(fd) == 0;
+    if(success && temporaryName.empty() && !linkTemporary(fd, filename.c_str(), temporaryName)) {
+        success = copyTemporary(fd, written, filename.c_str(), temporaryName);
+    }
+    if(close(fd) != 0) {
+        success = false;
+    }
+    fd = -1;
+    if(!success || rename(temporaryName.c_str(), filename.c_str()) != 0) {
+        return false;
+    }
+    temporaryName.clear();
+    if(configuredPolicy != SyncPolicy::DIRECTORY) {
+        return true;
+    }
+    int directoryFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(directoryFd < 0) {
+        return false;
+    }
+    success = fsync(directoryFd) == 0;
+    close(directoryFd);
+    return success;
+}
+
+//! A function variable.
+/*!
+  A function that writes the data with one FileReplacement.
+  Return type: boolean.
+*/
+bool replaceFile(const char* filename, const uint8_t* data, size_t size) {
+    FileReplacement replacement;
+    return replacement.open(filename) && replacement.write(data, size) && replacement.commit();
+}
+
+//! A function variable.
+/*!
+  A function that flushes the patched file. Patching changes no directory entry, so FILE and DIRECTORY do the same.
+  Return type: boolean.
+*/
+bool syncPatchedFile(int fd) {
+    return configuredPolicy == SyncPolicy::NONE || fsync(fd) == 0;
+}
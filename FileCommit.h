@@ -0,0 +1,121 @@
+//!  A file commit module.
+/*!
+  Functions that replace a file atomically: the new contents are written to an unnamed O_TMPFILE file
+  (or a temporary name where the filesystem has no O_TMPFILE) in the same directory, in one large write or piece
+  by piece as they are produced, and only then take the place of the old file with rename. A crash at any point leaves either the old or the new file, never a truncated one.
+  How much is flushed to disk before and after the rename is set by the sync policy.
+  The new file keeps the permission bits of the old one, but not its owner and group: it belongs to the user
+  and group of the process, as any newly created file does.
+*/
+
+#ifndef ImageSteganography_FILE_COMMIT_H
+#define ImageSteganography_FILE_COMMIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//! An enum.
+/*! An enum that stores what is flushed to disk when a file is written. */
+enum class SyncPolicy {
+    NONE, /*!< Enum value NONE, nothing; the rename is atomic, but the new contents may be lost on power failure. */
+    FILE, /*!< Enum value FILE, the contents of the file before it is renamed (default). */
+    DIRECTORY /*!< Enum value DIRECTORY, the contents of the file and then the directory entry of the rename. */
+};
+
+//! A function variable.
+/*!
+  A function that returns the name of the sync policy, as given on the command line.
+*/
+const char* syncPolicyName(SyncPolicy policy);
+
+//! A function variable.
+/*!
+  A function that takes the name of a sync policy (none, file, dir) and stores the matching value.
+  Return type: boolean.
+*/
+bool parseSyncPolicy(const std::string& name, SyncPolicy& policy);
+
+//! A function variable.
+/*!
+  A function that returns the sync policy files are written with.
+*/
+SyncPolicy syncPolicy();
+
+//! A function variable.
+/*!
+  A function that sets the sync policy files are written with.
+*/
+void setSyncPolicy(SyncPolicy policy);
+
+//! A class.
+/*! A class that writes the new contents of a file piece by piece and then replaces the file with them. */
+class FileReplacement {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates a replacement with no file.
+    */
+    FileReplacement() {}
+
+    //! A destructor.
+    /*!
+      A destructor that removes the new file when it was not committed, leaving the old file as it was.
+    */
+    ~FileReplacement();
+
+    FileReplacement(const FileReplacement&) = delete;
+    FileReplacement& operator=(const FileReplacement&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that creates the new file next to the file it replaces, with the same permissions.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that appends size bytes to the new file. After a failed write every later call fails too.
+      Return type: boolean.
+    */
+    bool write(const uint8_t* data, size_t size);
+
+    //! A function variable.
+    /*!
+      A function that returns how many bytes were written to the new file.
+    */
+    uint64_t size() const;
+
+    //! A function variable.
+    /*!
+      A function that flushes the new file following the sync policy and renames it over the old one.
+      Return type: boolean.
+    */
+    bool commit();
+
+private:
+    std::string filename; //!< A variable that stores the name of the file that is replaced.
+    std::string directory; //!< A variable that stores the directory of the file.
+    std::string temporaryName; //!< A variable that stores the name of the new file, empty while it has none.
+    int fd = -1; //!< A variable that stores the new file.
+    bool failed = false; //!< A variable that tells whether a write failed.
+    uint64_t written = 0; //!< A variable that stores how many bytes were written to the new file.
+};
+
+//! A function variable.
+/*!
+  A function that replaces the file with size bytes of data, atomically, following the sync policy.
+  The new file keeps the permissions of the file it replaces. On failure the old file is left as it was.
+  Return type: boolean.
+*/
+bool replaceFile(const char* filename, const uint8_t* data, size_t size);
+
+//! A function variable.
+/*!
+  A function that flushes a file that was changed in place, unless the sync policy is NONE.
+  Return type: boolean.
+*/
+bool syncPatchedFile(int fd);
+
+#endif //ImageSteganography_FILE_COMMIT_H
@@ -6,11 +6,22 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
+#include <memory>
+#include <vector>
 #include "stb_image.h"
 #include "stb_image_write.h"
 
+#include "FileCommit.h"
 #include "Image.h"
+#include "LsbKernels.h"
+#include "MappedFile.h"
+#include "ParallelKernels.h"
+#include "PngProfile.h"
+#include "PayloadStream.h"
+#include "PngReader.h"
 
 //! A constructor.
 /*!
@@ -19,10 +30,30 @@
   and calculates the size of the file.
   If the file wasn't successfully loaded constructor displays the message specifying the filename.
 */
-Image::Image(const char* filename) {
-    if(read(filename)) {
+Image::Image(const char* filename) : Image(filename, LoadMode::FULL) {
+}
+
+//! A constructor.
+/*!
+  A constructor that takes the filename and how much of it is decoded.
+  It displays the same messages as the constructor above and calculates the size of the pixel data in every mode.
+*/
+Image::Image(const char* filename, LoadMode mode) {
+    bool success = false;
+    switch(mode) {
+        case LoadMode::HEADER_ONLY:
+            success = readInfo(filename);
+            break;
+        case LoadMode::STEGO_PREFIX:
+            success = readStegoPrefix(filename);
+            break;
+        default:
+            success = read(filename);
+            break;
+    }
+    if(success) {
         printf("Read %s\n", filename);
-        size = w * h * channels; //!< A variable that stores the value of the image size.
+        size = (size_t)w * h * channels; //!< A variable that stores the value of the image size.
     }
     else {
         printf("Failed to read %s\n", filename);
@@ -34,8 +65,8 @@ Image::Image(const char* filename) {
   A constructor that takes the value of the image width, height and the number of the channels.
 */
 Image::Image(int w, int h, int channels) : w(w), h(h), channels(channels) {
-    size = w * h * channels; //!< A variable that stores the value of the image size.
-    data = new uint8_t[size]; //!< A variable that stores image data, 1 bit - unit8_t.
+    size = (size_t)w * h * channels; //!< A variable that stores the value of the image size.
+    data = (uint8_t*)malloc(size); //!< A variable that stores image data, 1 bit - unit8_t. Freed by stbi_image_free like loaded data.
 }
 
 //! A constructor.
@@ -57,39 +88,138 @@ Image::~Image(){
 //! A function variable.
 /*!
   A function that takes the file name and returns the data.
-  It loads the data from the file returns it.
+  PNG files are decoded by the row reader, whose unfiltering runs the SSE2 kernels of PngFilters; its rows are the ones
+  stbi_load returns. Other files, and PNGs the row reader does not take (interlaced ones), are mapped (or read with pread
+  where they cannot be mapped) and decoded from memory, which avoids the stdio copy and the many small reads of stbi_load.
+  Files stb cannot take from memory (over 2 GB) or cannot open this way are still loaded by stbi_load.
   Return type: boolean.
 */
 bool Image::read(const char* filename) {
-    data = stbi_load(filename, &w, &h, &channels, 0);
+    PngReader reader;
+    if(reader.open(filename)) {
+        data = (uint8_t*)malloc((size_t)reader.height * reader.width * reader.channels);
+        if(data != NULL && reader.readRows(data, reader.height)) {
+            w = reader.width;
+            h = reader.height;
+            channels = reader.channels;
+            return true;
+        }
+        stbi_image_free(data);
+        data = NULL;
+    }
+    MappedFile file;
+    if(!file.open(filename) || file.size() > INT_MAX) {
+        data = stbi_load(filename, &w, &h, &channels, 0);
+        return data != NULL;
+    }
+    data = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &channels, 0);
     return data != NULL;
 }
 
+//! A function variable.
+/*!
+  A function that takes the file name and reads the image header.
+  PNG headers are parsed by the row reader, which counts the alpha channel a tRNS colour adds, as stbi_load does
+  (stbi_info stops after IHDR and misses it). Other formats use stbi_info. Neither inflates or unfilters any pixel data.
+  Return type: boolean.
+*/
+bool Image::readInfo(const char* filename) {
+    PngReader reader;
+    if(reader.open(filename)) {
+        w = reader.width;
+        h = reader.height;
+        channels = reader.channels;
+        return true;
+    }
+    return stbi_info(filename, &w, &h, &channels) != 0;
+}
+
+//! A function variable.
+/*!
+  A function that takes the file name and decodes the rows of a PNG up to the end of the payload.
+  It decodes the rows of the longest stego header first, reads the header from them and then decodes
+  the rows the announced payload reaches; inflating stops there. The buffer is allocated zeroed for the whole
+  image, so the pages of rows that are never decoded are never touched.
+  Return type: boolean.
+*/
+bool Image::readStegoPrefix(const char* filename) {
+    PngReader reader;
+    if(!reader.open(filename)) {
+        return read(filename);
+    }
+    w = reader.width;
+    h = reader.height;
+    channels = reader.channels;
+    size_t rowSize = (size_t)w * channels;
+    data = (uint8_t*)calloc((size_t)h, rowSize);
+    if(data == NULL) {
+        return false;
+    }
+    auto decodeUpTo = [&](uint64_t carrierBytes) {
+        uint64_t rows = std::min<uint64_t>((uint64_t)h, (carrierBytes + rowSize - 1) / rowSize);
+        if(rows <= (uint64_t)reader.rowsRead) {
+            return true;
+        }
+        return reader.readRows(data + reader.rowsRead * rowSize, (int)rows - reader.rowsRead);
+    };
+
+    StegoHeader header;
+    bool success = decodeUpTo(STEG_HEADER_READ_SIZE);
+    if(success && readStegoHeader(data, (size_t)h * rowSize, channels, header)) {
+        success = decodeUpTo(stegoCapacityNeeded(header.settings, channels, header.messageSize));
+    }
+    if(!success) {
+        stbi_image_free(data);
+        data = NULL;
+        return read(filename);
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that stb_image_write calls with every piece of the file it renders; it appends the piece to the buffer.
+*/
+static void appendToBuffer(void* context, void* data, int size) {
+    std::vector<uint8_t>* buffer = (std::vector<uint8_t>*)context;
+    buffer->insert(buffer->end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
 //! A function variable.
 /*!
   A function that takes writes the data into the file.
+  The file is rendered into memory first and then replaces the old file atomically (see replaceFile), so the many small
+  writes of the stb writers never reach the file system and a crash cannot leave a truncated image behind.
+  PNG files are rendered by the parallel PNG writer with the active PNG write profile (see setPngProfile).
   If the writing process was successful it prints out the message specifying the filename, weight, height, channels and size.
   If the writing process wasn't successful it prints out the message specifying the filename, weight, height, channels and size.
   Return type: boolean.
 */
 bool Image::write(const char* filename) {
     ImageType type = getFileType(filename);
-    int success;
+    std::vector<uint8_t> rendered;
+    rendered.reserve(size + 1024);
+    int success = 0;
     switch(type) {
         case ImageType::PNG:
-            success = stbi_write_png(filename, w, h, channels, data, w*channels);
+            success = renderPng(data, w, h, channels, rendered);
             break;
         case ImageType::BMP:
-            success = stbi_write_bmp(filename, w, h, channels, data);
+            success = stbi_write_bmp_to_func(appendToBuffer, &rendered, w, h, channels, data);
             break;
         case ImageType::JPG:
-            success = stbi_write_jpg(filename, w, h, channels, data, 100);
+            success = stbi_write_jpg_to_func(appendToBuffer, &rendered, w, h, channels, data, 100);
             break;
         case ImageType::TGA:
-            success = stbi_write_tga(filename, w, h, channels, data);
+            success = stbi_write_tga_to_func(appendToBuffer, &rendered, w, h, channels, data);
+            break;
+        case ImageType::PPM:
+            printf("PPM and PGM files can only be patched in place, %s cannot be rewritten as a whole\n", filename);
+            break;
+        default:
             break;
     }
-    if (success != 0) {
+    if (success != 0 && replaceFile(filename, rendered.data(), rendered.size())) {
         printf("Wrote %s, %d, %d, %d, %zu\n", filename, w, h, channels, size);
         return true;
     }
@@ -116,6 +246,8 @@ ImageType Image::getFileType(const char* filename) {
             return ImageType::BMP;
         } else if (strcmp(ext, ".tga") == 0) {
             return ImageType::TGA;
+        } else if (strcmp(ext, ".ppm") == 0 || strcmp(ext, ".pgm") == 0) {
+            return ImageType::PPM;
         }
     }
     return ImageType::UNRECOGNIZED;
@@ -125,39 +257,91 @@ ImageType Image::getFileType(const char* filename) {
 /*!
   A function that takes the message, checks encoding possibility, encodes the message if possible and returns it.
   If the size of the message is too large for the image then it returns the massage specifying the message and image size.
-  It passes the message length to the data of the image and inserts the message to the image.
+  It writes the stego header with the message length and the settings to the data of the image
+  and inserts the message into the chosen number of low bits of the selected channels of the following pixels.
 */
-Image& Image::encodeMessage(const char* message) {
-    uint32_t len = strlen(message) * 8; //!< A variable that stores the length of the message.
-                                        //!< Calculating how many bits are required to encode the message.
+Image& Image::encodeMessage(const char* message, const StegoSettings& settings) {
+    size_t len = strlen(message); //!< A variable that stores the length of the message in bytes.
 
-    if(false == checkEncodingPossibility(message)) {
+    if(false == checkEncodingPossibility(message, settings)) {
         return *this;
     }
+    StegoSettings effective = settings; //!< The settings with a mask of all channels cleared.
+    effective.normalize(channels);
+
+    writeStegoHeader(data, size, effective, channels, len);
+    embedBitsParallel(channels, effective.channelMask, effective.bitsPerChannel,
+                      data + stegoPayloadOffset(effective, channels, len), (const uint8_t*)message, len);
+    return *this;
+}
+
+//! A function variable.
+/*!
+  A function that takes a file descriptor and the number of payload bytes it delivers, checks encoding possibility
+  and encodes the payload chunk by chunk if possible.
+  Every chunk is a whole number of kernel units, so it lands on the same carrier bytes as in a single embedding call.
+  If the descriptor ends early the image is left partly encoded and false is returned, so it must not be written.
+  Return type: boolean.
+*/
+bool Image::encodeStream(int fd, uint64_t payloadSize, const StegoSettings& settings) {
+    if(false == checkEncodingPossibility(payloadSize, settings)) {
+        return false;
+    }
+    StegoSettings effective = settings; //!< The settings with a mask of all channels cleared.
+    effective.normalize(channels);
 
-    for(uint8_t i = 0; i < STEG_HEADER_SIZE; ++i) {
-        data[i] &= 0xFE;
-        data[i] |= (len >> (STEG_HEADER_SIZE - 1 - i)) & 1UL;
+    size_t unitPayload = 0;
+    size_t unitCarriers = 0;
+    carrierUnit(channels, effective.channelMask, effective.bitsPerChannel, unitPayload, unitCarriers);
+    size_t chunkSize = PAYLOAD_CHUNK_SIZE / unitPayload * unitPayload;
+    if(chunkSize > payloadSize) {
+        chunkSize = (size_t)payloadSize;
     }
+    std::unique_ptr<uint8_t[]> chunk(new uint8_t[chunkSize]);
 
-    for(uint32_t i = 0; i < len; ++i) {
-        data[i + STEG_HEADER_SIZE] &= 0xFE;
-        data[i + STEG_HEADER_SIZE] |= (message[i / 8] >> ((len - 1 - i) % 8)) & 1;
+    writeStegoHeader(data, size, effective, channels, payloadSize);
+    uint8_t* carrier = data + stegoPayloadOffset(effective, channels, payloadSize);
+    for(uint64_t done = 0; done < payloadSize; done += chunkSize) {
+        size_t count = (size_t)std::min<uint64_t>(chunkSize, payloadSize - done);
+        if(!readPayloadChunk(fd, chunk.get(), count)) {
+            printf("The payload ended after %llu of %llu bytes\n", (unsigned long long)done, (unsigned long long)payloadSize);
+            return false;
+        }
+        embedBitsParallel(channels, effective.channelMask, effective.bitsPerChannel,
+                          carrier + done / unitPayload * unitCarriers, chunk.get(), count);
     }
-    return *this;
+    return true;
 }
 
 //! A function variable.
 /*!
   A function that takes the message, image and checks the possibility of encoding it into the bits of image.
+  The settings have to match the image channels, and the header and the carrier bytes the message takes
+  at the chosen bits per channel and channel mask have to fit in the image.
   It prints out appropriate output (indicating the possibility).
   Return type: boolean.
 */
-bool Image::checkEncodingPossibility(const char* message)
+bool Image::checkEncodingPossibility(const char* message, const StegoSettings& settings)
+{
+    return checkEncodingPossibility((uint64_t)strlen(message), settings);
+}
+
+//! A function variable.
+/*!
+  A function that takes the payload size in bytes and checks the possibility of encoding it into the bits of image,
+  like the function above.
+  Return type: boolean.
+*/
+bool Image::checkEncodingPossibility(uint64_t messageSize, const StegoSettings& settings)
 {
-    uint32_t len = strlen(message) * 8;
-    if((len + STEG_HEADER_SIZE) > size) {
-        printf("This message is too large (%lu bits / %zu bits)\n", len + STEG_HEADER_SIZE, size);
+    StegoSettings effective = settings;
+    if(!effective.normalize(channels)) {
+        printf("The channel mask does not match the %d channels of the image\n", channels);
+        return false;
+    }
+    uint64_t needed = stegoCapacityNeeded(effective, channels, messageSize);
+    if(needed > size) {
+        printf("This message is too large (%llu carrier bytes / %zu carrier bytes)\n", (unsigned long long)needed, size);
         return false;
     }
     else return true;
@@ -166,19 +350,73 @@ bool Image::checkEncodingPossibility(const char* message)
 //! A function variable.
 /*!
   A function that takes the message, decodes the message and returns its size.
-  It loads the bit after bit and puts the data into the buffer.
-  The length of the message is given in bits so it needs to be divided by 8.
+  It reads the stego header first, which tells the message size, the bits per channel and the channel mask,
+  then collects the carrier bits with the matching extraction kernel and puts the data into the buffer.
 */
 Image& Image::decodeMessage(char* buffer, size_t* messageLenght) {
-    uint32_t len = 0; //!< A variable that stores the length of the message.
+    StegoHeader header; //!< A variable that stores the header with the length of the message.
 
-    for (uint8_t i = 0; i < STEG_HEADER_SIZE; ++i) {
-        len = (len << 1) | (data[i] & 1);
+    *messageLenght = 0;
+    if(!readStegoHeader(data, size, channels, header)) {
+        printf("No hidden message found\n");
+        return *this;
     }
-    *messageLenght = len / 8;
+    *messageLenght = header.messageSize;
 
-    for (uint32_t i = 0; i < len; ++i ) {
-        buffer[i/8] = (buffer[i / 8] << 1) | (data[i + STEG_HEADER_SIZE] & 1);
-    }
+    extractBitsParallel(channels, header.settings.channelMask, header.settings.bitsPerChannel,
+                        (uint8_t*)buffer, data + header.payloadOffset, header.messageSize);
     return *this;
+}
+
+//! A function variable.
+/*!
+  A function that takes the sink, decodes the message and passes it to the sink.
+  A buffer sink with room for the whole message receives it from a single extraction call; otherwise the message
+  is extracted block by block into one buffer of whole kernel units and written out in order.
+  Return type: boolean.
+*/
+bool Image::decodeStream(PayloadSink& sink) {
+    return decodeCarrier(data, size, channels, sink);
+}
+
+//! A function variable.
+/*!
+  A function that takes the carrier bytes, decodes the message and passes it to the sink, as described above.
+  Return type: boolean.
+*/
+bool Image::decodeCarrier(const uint8_t* data, size_t size, int channels, PayloadSink& sink) {
+    StegoHeader header; //!< A variable that stores the header with the length of the message.
+
+    if(!readStegoHeader(data, size, channels, header)) {
+        printf("No hidden message found\n");
+        return false;
+    }
+    const uint8_t* carrier = data + header.payloadOffset;
+    uint8_t* direct = sink.reserve(header.messageSize);
+    if(direct != nullptr) {
+        extractBitsParallel(channels, header.settings.channelMask, header.settings.bitsPerChannel,
+                            direct, carrier, header.messageSize);
+        return true;
+    }
+    if(sink.buffer != nullptr) {
+        printf("The message (%zu bytes) does not fit in the buffer (%zu bytes)\n", header.messageSize, sink.capacity);
+        return false;
+    }
+
+    size_t unitPayload = 0;
+    size_t unitCarriers = 0;
+    carrierUnit(channels, header.settings.channelMask, header.settings.bitsPerChannel, unitPayload, unitCarriers);
+    size_t blockSize = std::min(header.messageSize, PAYLOAD_CHUNK_SIZE / unitPayload * unitPayload);
+    std::unique_ptr<uint8_t[]> block(new uint8_t[blockSize]);
+
+    for(size_t done = 0; done < header.messageSize; done += blockSize) {
+        size_t count = std::min(blockSize, header.messageSize - done);
+        extractBitsParallel(channels, header.settings.channelMask, header.settings.bitsPerChannel,
+                            block.get(), carrier + done / unitPayload * unitCarriers, count);
+        if(!sink.write(block.get(), count)) {
+            printf("Failed to write the message after %zu of %zu bytes\n", done, header.messageSize);
+            return false;
+        }
+    }
+    return true;
 }
\ No newline at end of file
@@ -6,12 +6,20 @@
 #ifndef ImageSteganography_IMAGE_H
 #define ImageSteganography_IMAGE_H
 
-#endif //ImageSteganography_IMAGE_H
-
 #include <cstdint>
 #include <cstdio>
 
-#define STEG_HEADER_SIZE sizeof(uint32_t) * 8
+#include "StegoHeader.h"
+
+struct PayloadSink;
+
+//! An enum.
+/*! An enum that stores how much of an image file is decoded. */
+enum class LoadMode {
+    FULL, /*!< Enum value FULL, every pixel (default). */
+    HEADER_ONLY, /*!< Enum value HEADER_ONLY, the width, height and channels. */
+    STEGO_PREFIX /*!< Enum value STEGO_PREFIX, the rows that hold the stego header and the payload. */
+};
 
 //! An enum.
 /*! An enum that stores file types. */
@@ -20,7 +28,8 @@ enum class ImageType {
     PNG, /*!< Enum value PNG. */
     JPG, /*!< Enum value JPG. */
     BMP, /*!< Enum value BMP. */
-    TGA  /*!< Enum value TGA. */
+    TGA, /*!< Enum value TGA. */
+    PPM  /*!< Enum value PPM, binary PPM and PGM files (read only). */
 };
 
 //! A structure.
@@ -29,9 +38,9 @@ enum class ImageType {
 struct Image {
     uint8_t* data = NULL; //!< A variable that stores the image data, 1 bit - unit8_t.
     size_t size = 0; //!< A variable that stores the value of the image size.
-    int w; //!< A variable that stores the value of the image width.
-    int h; //!< A variable that stores the value of the image height.
-    int channels; //!< A variable that stores the number of channels of the image.
+    int w = 0; //!< A variable that stores the value of the image width.
+    int h = 0; //!< A variable that stores the value of the image height.
+    int channels = 0; //!< A variable that stores the number of channels of the image.
                   //!< Channels specify how many colours can one pixel combine (RGB or RGBA).
 
     //! A constructor.
@@ -40,6 +49,14 @@ struct Image {
     */
     Image(const char* filename);
 
+    //! A constructor.
+    /*!
+      A constructor that takes the filename and how much of it is decoded.
+      HEADER_ONLY reads only the width, height and channels; the image has no data then, which is enough
+      to check capacities and print information. STEGO_PREFIX decodes only the rows decodeMessage and decodeStream read.
+    */
+    Image(const char* filename, LoadMode mode);
+
     //! A constructor.
     /*!
       A constructor that takes the value of the image width, height and the number of the channels.
@@ -65,9 +82,26 @@ struct Image {
     */
     bool read(const char* filename);
 
+    //! A function variable.
+    /*!
+      A function that takes the file name and reads the width, height and channels without decoding the pixels.
+      Return type: boolean.
+    */
+    bool readInfo(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that takes the file name and decodes only the rows that hold the stego header and the payload it announces.
+      The other rows stay zero, so the image must not be written. Files the PNG row reader cannot stream
+      (other formats, interlaced PNGs) are read completely.
+      Return type: boolean.
+    */
+    bool readStegoPrefix(const char* filename);
+
     //! A function variable.
     /*!
       A function that takes writes the data on the file and returns the message saying whether the process was successful or not.
+      The file is rendered in memory and replaces the old one atomically; how much is flushed follows setSyncPolicy.
       Return type: boolean.
     */
     bool write(const char* filename);
@@ -76,24 +110,60 @@ struct Image {
     /*!
       A function that takes the file name and returns the file type.
     */
-    ImageType getFileType(const char* filename);
+    static ImageType getFileType(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that encodes the message with the given settings and returns it.
+    */
+    Image& encodeMessage(const char* message, const StegoSettings& settings = StegoSettings());
 
     //! A function variable.
     /*!
-      A function that encodes the message and returns it.
+      A function that encodes payloadSize bytes read from the file descriptor with the given settings.
+      The payload is read and embedded in chunks of PAYLOAD_CHUNK_SIZE bytes, so it is never held in memory as a whole.
+      Return type: boolean.
     */
-    Image& encodeMessage(const char* message);
+    bool encodeStream(int fd, uint64_t payloadSize, const StegoSettings& settings = StegoSettings());
 
     //! A function variable.
     /*!
       A function that decodes the message and returns its size.
+      The settings the message was encoded with are read from the stego header.
     */
     Image& decodeMessage(char* buffer, size_t* messageLenght);
 
     //! A function variable.
     /*!
-      A function that checks the encoding possibility, based on message length.
+      A function that decodes the message into the sink, in blocks of PAYLOAD_CHUNK_SIZE bytes for descriptor sinks
+      and in one piece for buffer sinks, so memory use does not depend on the message size.
+      The settings the message was encoded with are read from the stego header.
       Return type: boolean.
     */
-    bool checkEncodingPossibility(const char* message);
+    bool decodeStream(PayloadSink& sink);
+
+    //! A function variable.
+    /*!
+      A function that decodes the message hidden in size bytes of pixels with the given number of channels
+      into the sink, like the function above. The carrier does not have to belong to an image: it can be
+      the first rows of one, as long as they reach the end of the payload, or pixels in a mapped file.
+      Return type: boolean.
+    */
+    static bool decodeCarrier(const uint8_t* data, size_t size, int channels, PayloadSink& sink);
+
+    //! A function variable.
+    /*!
+      A function that checks the encoding possibility, based on message length and the settings.
+      Return type: boolean.
+    */
+    bool checkEncodingPossibility(const char* message, const StegoSettings& settings = StegoSettings());
+
+    //! A function variable.
+    /*!
+      A function that checks the encoding possibility, based on the payload size in bytes and the settings.
+      Return type: boolean.
+    */
+    bool checkEncodingPossibility(uint64_t messageSize, const StegoSettings& settings = StegoSettings());
 };
+
+#endif //ImageSteganography_IMAGE_H
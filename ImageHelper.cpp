@@ -3,18 +3,54 @@
     A class with check, encode, decode, get information about file type functions.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CarrierPatch.h"
 #include "ImageHelper.h"
+#include "ImageView.h"
+#include "PayloadStream.h"
+#include "PngProfile.h"
+#include "PngSplice.h"
+#include "PngStream.h"
+
+//! A function variable.
+/*!
+  A function that opens the payload file ("-" for standard input) and finds out its size.
+  It prints out appropriate output when the file cannot be opened or its size is unknown.
+  Return type: int, the file descriptor or -1.
+*/
+static int openPayload(const std::string& payloadPath, uint64_t sizeHint, uint64_t& payloadSize) {
+    int fd = payloadPath == "-" ? STDIN_FILENO : open(payloadPath.c_str(), O_RDONLY);
+    if(fd < 0) {
+        std::cerr << "Failed to open the payload " << payloadPath << std::endl;
+        return -1;
+    }
+    if(!payloadStreamSize(fd, sizeHint, payloadSize)) {
+        std::cerr << "The size of the payload " << payloadPath << " is unknown, specify it with --size" << std::endl;
+        if(fd != STDIN_FILENO) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
 
 //! A function variable.
 /*!
   A function that checks if it is possible to encode a message into the image.
+  Only the image header is read, the capacity does not depend on the pixels.
 */
 void ImageHelper::check() {
-    image = std::unique_ptr<Image>(new Image(filename.c_str()));
+    image = std::unique_ptr<Image>(new Image(filename.c_str(), LoadMode::HEADER_ONLY));
     if(nullptr == image) {
         std::cerr << "Image loading has not succeed." << std::endl;
     }
-    auto res = image->checkEncodingPossibility(message.c_str());
+    auto res = image->checkEncodingPossibility(message.c_str(), settings);
     if(res) {
         std::cout << "It is possible to encode the message into the image" << std::endl;
         return;
@@ -25,44 +61,293 @@ void ImageHelper::check() {
 //! A function variable.
 /*!
   A function that encodes the message into the image.
+  Uncompressed BMP, TGA and PPM files are patched in place, PNG files written by this program get only their leading
+  bands re-encoded and large PNG files are streamed; other files are decoded, encoded and rewritten.
 */
 void ImageHelper::encode() {
+    auto embed = [this](Image& prefix) {
+        prefix.encodeMessage(message.c_str(), settings);
+        return true;
+    };
+    size_t offset = 0;
+    auto readMessage = [&](uint8_t* buffer, size_t size) {
+        memcpy(buffer, message.data() + offset, size);
+        offset += size;
+        return true;
+    };
+    if(encodeInPlace(message.size(), embed) || encodeSpliced(message.size(), embed) || encodeStreamed(message.size(), readMessage)) {
+        return;
+    }
     image = std::unique_ptr<Image>(new Image(filename.c_str()));
     if(nullptr == image) {
         std::cerr << "Image loading has not succeed." << std::endl;
     }
-    auto res = image->checkEncodingPossibility(message.c_str());
+    auto res = image->checkEncodingPossibility(message.c_str(), settings);
     if(res) {
         std::cout << "Check successful. Encoding..." << std::endl;
-        image->encodeMessage(message.c_str());
+        image->encodeMessage(message.c_str(), settings);
         image->write(filename.c_str());
         return;
     }
     std::cout << "Encoding is not possible. Pre-check failed" << std::endl;
 }
 
+//! A function variable.
+/*!
+  A function that checks if it is possible to encode the payload file into the image, from the image header only.
+*/
+void ImageHelper::checkFile(const std::string& payloadPath, uint64_t sizeHint) {
+    image = std::unique_ptr<Image>(new Image(filename.c_str(), LoadMode::HEADER_ONLY));
+    uint64_t payloadSize = 0;
+    int fd = openPayload(payloadPath, sizeHint, payloadSize);
+    if(fd < 0) {
+        return;
+    }
+    if(fd != STDIN_FILENO) {
+        close(fd);
+    }
+    if(image->checkEncodingPossibility(payloadSize, settings)) {
+        std::cout << "It is possible to encode the payload (" << payloadSize << " bytes) into the image" << std::endl;
+        return;
+    }
+    std::cout << "It is not possible to encode the payload (" << payloadSize << " bytes) into the image" << std::endl;
+}
+
+//! A function variable.
+/*!
+  A function that encodes the payload file into the image and writes the image only when the whole payload was read.
+  Uncompressed BMP, TGA and PPM files are patched in place, PNG files written by this program are spliced
+  and large PNG files are streamed.
+*/
+void ImageHelper::encodeFile(const std::string& payloadPath, uint64_t sizeHint) {
+    uint64_t payloadSize = 0;
+    int fd = openPayload(payloadPath, sizeHint, payloadSize);
+    if(fd < 0) {
+        return;
+    }
+    auto embed = [&](Image& prefix) {
+        return prefix.encodeStream(fd, payloadSize, settings);
+    };
+    auto readFile = [fd](uint8_t* buffer, size_t size) {
+        return readPayloadChunk(fd, buffer, size);
+    };
+    if(encodeInPlace(payloadSize, embed) || encodeSpliced(payloadSize, embed) || encodeStreamed(payloadSize, readFile)) {
+        if(fd != STDIN_FILENO) {
+            close(fd);
+        }
+        return;
+    }
+    image = std::unique_ptr<Image>(new Image(filename.c_str()));
+    bool res = image->encodeStream(fd, payloadSize, settings);
+    if(fd != STDIN_FILENO) {
+        close(fd);
+    }
+    if(res) {
+        image->write(filename.c_str());
+        return;
+    }
+    std::cout << "Encoding is not possible. The image was not modified" << std::endl;
+}
+
 //! A function variable.
 /*!
   A function that decodes the message into the image.
 */
 void ImageHelper::decode() {
-    image = std::unique_ptr<Image>(new Image(filename.c_str()));
+    char buffer[MAX_BUFFER_SIZE]{0};
+    PayloadSink sink = PayloadSink::toBuffer((uint8_t*)buffer, MAX_BUFFER_SIZE - 1);
+    if(!decodeInto(sink)) {
+        std::cout << "Decoding failed. Use -o to write a long or binary message to a file" << std::endl;
+        return;
+    }
+
+    printf("Decoding successful. Hidden message: %s (%zu)\n", buffer, (size_t)sink.written);
+}
+
+//! A function variable.
+/*!
+  A function that decodes the message into the output file.
+  A regular output file is replaced only once the whole payload was written, so a failed decoding leaves it as it was;
+  anything else (a terminal, a pipe, a device) is written to directly, since opening it destroys nothing.
+*/
+void ImageHelper::decodeFile(const std::string& outputPath) {
+    struct stat info;
+    bool res = false;
+    uint64_t written = 0;
+    if(stat(outputPath.c_str(), &info) != 0 || S_ISREG(info.st_mode)) {
+        FileReplacement out;
+        if(!out.open(outputPath.c_str())) {
+            std::cerr << "Failed to open the output file " << outputPath << std::endl;
+            return;
+        }
+        PayloadSink sink = PayloadSink::toFile(out);
+        res = decodeInto(sink) && out.commit();
+        written = sink.written;
+    }
+    else {
+        int fd = open(outputPath.c_str(), O_WRONLY);
+        if(fd < 0) {
+            std::cerr << "Failed to open the output file " << outputPath << std::endl;
+            return;
+        }
+        PayloadSink sink = PayloadSink::toDescriptor(fd);
+        res = decodeInto(sink);
+        if(close(fd) != 0) {
+            res = false;
+        }
+        written = sink.written;
+    }
+    if(res) {
+        std::cout << "Decoding successful. Wrote " << written << " bytes to " << outputPath << std::endl;
+        return;
+    }
+    std::cout << "Decoding failed" << std::endl;
+}
+
+//! A function variable.
+/*!
+  A function that decodes the message into the sink. Uncompressed BMP, TGA and PPM files are read through a mapping,
+  where only the pages of the header and payload rows are touched; other files decode the rows up to the end of the payload.
+  Return type: boolean.
+*/
+bool ImageHelper::decodeInto(PayloadSink& sink) {
+    ImageView view;
+    if(view.open(filename.c_str())) {
+        bool res = view.decodeStream(sink);
+        printf("Read %d of %d rows of %s\n", view.rowsRead, view.h, filename.c_str());
+        return res;
+    }
+    image = std::unique_ptr<Image>(new Image(filename.c_str(), LoadMode::STEGO_PREFIX));
+    return image->decodeStream(sink);
+}
+
+//! A function variable.
+/*!
+  A function that patches an uncompressed BMP, TGA or PPM carrier in place.
+  The capacity is checked against the whole image before any row is read, and the file is only written
+  when embed succeeded, so a failed embedding leaves it untouched.
+  The rows read reach at least every version 3 header an earlier embedding may have left, so the new header can supersede them.
+*/
+bool ImageHelper::encodeInPlace(uint64_t payloadSize, const std::function<bool(Image&)>& embed) {
+    CarrierPatch patch;
+    if(!patch.open(filename.c_str())) {
+        return false;
+    }
+    StegoSettings effective = settings;
+    if(!effective.normalize(patch.layout.channels)) {
+        return false;
+    }
+    uint64_t needed = stegoCapacityNeeded(effective, patch.layout.channels, payloadSize);
+    if(needed > (uint64_t)patch.layout.width * patch.layout.height * patch.layout.channels) {
+        return false;
+    }
+    image = patch.loadPrefix(std::max<uint64_t>(needed, STEG_HEADER_READ_SIZE));
     if(nullptr == image) {
-        std::cerr << "Image loading has not succeed." << std::endl;
+        return false;
     }
-    char buffer[MAX_BUFFER_SIZE]{0};
-    size_t len = 0;
-    image->decodeMessage(buffer, &len);
+    printf("Read %d of %d rows of %s\n", image->h, patch.layout.height, filename.c_str());
+    if(!embed(*image)) {
+        std::cout << "Encoding is not possible. The image was not modified" << std::endl;
+        return true;
+    }
+    size_t written = 0;
+    if(!patch.commit(*image, written)) {
+        std::cerr << "Failed to patch " << filename << " in place" << std::endl;
+        return true;
+    }
+    printf("Patched %s in place, %zu bytes written\n", filename.c_str(), written);
+    return true;
+}
 
-    printf("Decoding successful. Hidden message: %s (%zu)\n", buffer, len);
+//! A function variable.
+/*!
+  A function that re-encodes the leading bands of a PNG file written by this program.
+  As in encodeInPlace, the capacity is checked against the whole image first and the file is only replaced
+  when embed succeeded.
+*/
+bool ImageHelper::encodeSpliced(uint64_t payloadSize, const std::function<bool(Image&)>& embed) {
+    PngSplice splice;
+    if(!splice.open(filename.c_str())) {
+        return false;
+    }
+    if(!splice.keepsFilters(pngWriteSettings(pngProfile()))) {
+        printf("The %s profile does not keep the filters of %s, rewriting the whole image\n", pngProfileName(pngProfile()),
+               filename.c_str());
+        return false;
+    }
+    StegoSettings effective = settings;
+    if(!effective.normalize(splice.channels)) {
+        return false;
+    }
+    uint64_t needed = stegoCapacityNeeded(effective, splice.channels, payloadSize);
+    if(needed > (uint64_t)splice.width * splice.height * splice.channels) {
+        return false;
+    }
+    image = splice.loadPrefix(needed);
+    if(nullptr == image) {
+        return false;
+    }
+    printf("Read %d of %d rows of %s\n", image->h, splice.height, filename.c_str());
+    if(!embed(*image)) {
+        std::cout << "Encoding is not possible. The image was not modified" << std::endl;
+        return true;
+    }
+    size_t reused = 0;
+    uint64_t fileSize = 0;
+    auto start = std::chrono::steady_clock::now();
+    if(!splice.commit(*image, reused, fileSize)) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return true;
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printPngWrite(splice.index.filter, fileSize, elapsed, "leading bands re-encoded");
+    size_t rowsPerBand = splice.index.rowsPerBand;
+    printf("Re-encoded %zu of %zu bands of %s, %zu compressed bytes kept\n", (image->h + rowsPerBand - 1) / rowsPerBand,
+           splice.index.checksums.size(), filename.c_str(), reused);
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that streams a PNG file through the embedding kernels and the band encoder.
+  Files named with another extension are left to Image::write, which picks the format by the extension.
+*/
+bool ImageHelper::encodeStreamed(uint64_t payloadSize, const std::function<bool(uint8_t*, size_t)>& readPayload) {
+    if(Image::getFileType(filename.c_str()) != ImageType::PNG) {
+        return false;
+    }
+    PngStreamEncoder stream;
+    if(!stream.open(filename.c_str())) {
+        return false;
+    }
+    if(!pngStreaming() && (uint64_t)stream.width * stream.height * stream.channels < PNG_STREAM_AUTO_SIZE) {
+        return false;
+    }
+    image = std::unique_ptr<Image>(new Image(filename.c_str(), LoadMode::HEADER_ONLY));
+    if(!image->checkEncodingPossibility(payloadSize, settings)) {
+        std::cout << "Encoding is not possible. The image was not modified" << std::endl;
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if(!stream.encode(settings, payloadSize, readPayload)) {
+        std::cerr << "Failed to stream " << filename << ", the image was not modified" << std::endl;
+        return true;
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool perRow = pngWriteSettings(pngProfile()).filter == FilterStrategy::EXHAUSTIVE;
+    printPngWrite(stream.filter, stream.fileSize, elapsed,
+                  perRow ? "streamed, with filters picked per row instead of the exhaustive search" : "streamed");
+    printf("Streamed %d rows of %s through a %zu byte row buffer\n", stream.height, filename.c_str(), stream.bufferSize);
+    return true;
 }
 
 //! A function variable.
 /*!
   A function that displays the information about chosen file type and image size.
+  Only the image header is read.
 */
 void ImageHelper::getInfo() {
-    image = std::unique_ptr<Image>(new Image(filename.c_str()));
+    image = std::unique_ptr<Image>(new Image(filename.c_str(), LoadMode::HEADER_ONLY));
     if(nullptr == image) {
         std::cerr << "Image loading has not succeed." << std::endl;
     }
@@ -89,6 +374,13 @@ void ImageHelper::getInfo() {
                 — unofficially, the initials PNG stood for the recursive acronym "PNG's not GIF".
             )===" << std::endl;
             break;
+        case ImageType::PPM:
+            std::cout << R"===(
+                The PPM (portable pixmap) and PGM (portable graymap) formats belong to the Netpbm family of image formats.
+                A binary file holds a short text header with the width, height and maximum sample value, followed by the uncompressed samples,
+                which makes the format a common exchange format between image processing tools.
+            )===" << std::endl;
+            break;
         case ImageType::TGA:
             std::cout << R"===(
                 Truevision TGA, often referred to as TARGA, is a raster graphics file format created by Truevision Inc. (now part of Avid Technology).
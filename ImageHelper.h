@@ -1,3 +1,4 @@
+#include <functional>
 #include <memory>
 #include <string>
 #include <iostream>
@@ -12,6 +13,8 @@ struct ImageHelper {
     ImageHelper() {}
     ImageHelper(const std::string& _filename) : ImageHelper(_filename, {}) {}
     ImageHelper(const std::string& _filename, const std::string& _message) : filename(_filename), message(_message) {}
+    ImageHelper(const std::string& _filename, const std::string& _message, const StegoSettings& _settings)
+        : filename(_filename), message(_message), settings(_settings) {}
 
     //! A function variable.
     /*!
@@ -25,6 +28,20 @@ struct ImageHelper {
     */
     void encode();
 
+    //! A function variable.
+    /*!
+      A function that checks if it is possible to encode the payload file ("-" for standard input) into the image.
+      sizeHint gives the payload size when it cannot be taken from the file (0 means no hint).
+    */
+    void checkFile(const std::string& payloadPath, uint64_t sizeHint);
+
+    //! A function variable.
+    /*!
+      A function that encodes the payload file ("-" for standard input) into the image, streamed in chunks.
+      sizeHint gives the payload size when it cannot be taken from the file (0 means no hint).
+    */
+    void encodeFile(const std::string& payloadPath, uint64_t sizeHint);
+
 
     //! A function variable.
     /*!
@@ -32,6 +49,46 @@ struct ImageHelper {
     */
     void decode();
 
+    //! A function variable.
+    /*!
+      A function that decodes the message of any size and writes it to the output file, block by block.
+    */
+    void decodeFile(const std::string& outputPath);
+
+    //! A function variable.
+    /*!
+      A function that decodes the message into the sink, from a mapping of the file when it is an uncompressed
+      BMP, TGA or PPM file and from the rows decoded up to the end of the payload otherwise.
+      Return type: boolean.
+    */
+    bool decodeInto(PayloadSink& sink);
+
+    //! A function variable.
+    /*!
+      A function that encodes a payload of payloadSize bytes into an uncompressed BMP, TGA or PPM file in place:
+      only the rows the payload reaches are read, embed runs on them and only the changed bytes are written back.
+      It returns false when the file is not such a carrier or the payload does not fit, so the caller rewrites the file instead.
+    */
+    bool encodeInPlace(uint64_t payloadSize, const std::function<bool(Image&)>& embed);
+
+    //! A function variable.
+    /*!
+      A function that encodes a payload of payloadSize bytes into a PNG file written by this program: only the bands
+      the payload reaches are decoded, embed runs on them and they are deflated again, the other compressed bands
+      are copied. It returns false when the file has no band index or the payload does not fit, so the caller
+      rewrites the file instead.
+    */
+    bool encodeSpliced(uint64_t payloadSize, const std::function<bool(Image&)>& embed);
+
+    //! A function variable.
+    /*!
+      A function that encodes a payload of payloadSize bytes, delivered in order by readPayload, into a PNG file
+      without decoding it as a whole (see PngStreamEncoder). It only takes files of PNG_STREAM_AUTO_SIZE decoded bytes
+      and more, or every PNG file when streaming was asked for; it returns false for the others, so the caller
+      rewrites the file instead.
+    */
+    bool encodeStreamed(uint64_t payloadSize, const std::function<bool(uint8_t*, size_t)>& readPayload);
+
     //! A function variable.
     /*!
       A function that displays the information about chosen file type and image size.
@@ -41,4 +98,5 @@ struct ImageHelper {
     std::unique_ptr<Image> image; //!< A unique pointer that manages image object.
     const std::string filename; //!< A constant variable that stores the file name.
     const std::string message; //!< A constant variable that stores the message.
+    const StegoSettings settings; //!< A constant variable that stores the settings the message is encoded with.
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+//!  An image view class.
+/*!
+    A class that maps an uncompressed image file and decodes messages from the rows that hold them.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Image.h"
+#include "ImageView.h"
+
+//! A destructor.
+/*!
+  A destructor that unmaps the file.
+*/
+ImageView::~ImageView() {
+    if(mapping != nullptr) {
+        munmap(mapping, length);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that maps the file and parses its header from the mapping.
+  Readahead is turned off, so reading the header does not pull the following pages in; readRows asks for the pages it needs.
+  Return type: boolean.
+*/
+bool ImageView::open(const char* filename) {
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    length = (size_t)info.st_size;
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(view == MAP_FAILED) {
+        return false;
+    }
+    mapping = (uint8_t*)view;
+    madvise(mapping, length, MADV_RANDOM);
+
+    size_t headerSize = length < CARRIER_HEADER_READ_SIZE ? length : CARRIER_HEADER_READ_SIZE;
+    if(!layout.parse(mapping, headerSize, filename, length) || layout.alphaMayBeReplaced) {
+        return false;
+    }
+    w = layout.width;
+    h = layout.height;
+    channels = layout.channels;
+    size = (size_t)w * h * channels;
+    data = layout.isDirect() ? mapping + layout.dataOffset : nullptr;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that returns the first rows of the image. The stored rows they come from are adjacent in the file
+  in either row order; the pages of the rows not read before are requested in one madvise call, and rows that
+  are not stored as image rows are reordered into the buffer.
+*/
+const uint8_t* ImageView::readRows(uint64_t carrierBytes) {
+    size_t rowSize = (size_t)w * channels;
+    uint64_t neededRows = (carrierBytes + rowSize - 1) / rowSize;
+    int rows = (int)(neededRows < (uint64_t)h ? neededRows : (uint64_t)h);
+    if(rows == 0) {
+        rows = 1;
+    }
+    if(rows > rowsRead) {
+        uint64_t first = layout.bottomUp ? layout.rowOffset(rows - 1) : layout.rowOffset(rowsRead);
+        uint64_t last = (layout.bottomUp ? layout.rowOffset(rowsRead) : layout.rowOffset(rows - 1)) + layout.rowStride;
+        uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+        uint64_t start = first / page * page;
+        madvise(mapping + start, (size_t)(last - start), MADV_WILLNEED);
+
+        if(data == nullptr) {
+            reordered.resize((size_t)rows * rowSize);
+            for(int y = rowsRead; y < rows; ++y) {
+                layout.toImageRow(mapping + layout.rowOffset(y), reordered.data() + (size_t)y * rowSize);
+            }
+        }
+        rowsRead = rows;
+    }
+    return data != nullptr ? data : reordered.data();
+}
+
+//! A function variable.
+/*!
+  A function that reads the stego header from the first rows, then the rows up to the end of the payload,
+  and decodes the message from them. When no header is found the rows of the header are passed on,
+  and decoding reports that there is no message.
+  Return type: boolean.
+*/
+bool ImageView::decodeStream(PayloadSink& sink) {
+    StegoHeader header; //!< A variable that stores the header with the length of the message.
+
+    const uint8_t* carrier = readRows(STEG_HEADER_READ_SIZE);
+    if(readStegoHeader(carrier, size, channels, header)) {
+        carrier = readRows(stegoCapacityNeeded(header.settings, channels, header.messageSize));
+    }
+    return Image::decodeCarrier(carrier, (size_t)rowsRead * w * channels, channels, sink);
+}
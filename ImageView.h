@@ -0,0 +1,77 @@
+//!  An image view class.
+/*!
+  A class that decodes messages from an uncompressed BMP, TGA or PPM file without loading it: the file is mapped
+  and the stego header and payload are read from the mapping, so only the pages that hold them are ever read from disk
+  and nothing is allocated for the rest of the image. When the stored rows are the image stbi_load would return
+  (top-down PPM and PGM files, top-down grey TGAs) data points straight into the mapping; otherwise only the rows
+  the header and payload occupy are reordered into a buffer.
+*/
+
+#ifndef ImageSteganography_IMAGE_VIEW_H
+#define ImageSteganography_IMAGE_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CarrierLayout.h"
+
+struct PayloadSink;
+
+//! A class.
+/*! A class that owns a read-only mapping of an uncompressed image file and reads messages from it. */
+class ImageView {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates a view with no file.
+    */
+    ImageView() {}
+
+    //! A destructor.
+    /*!
+      A destructor that unmaps the file.
+    */
+    ~ImageView();
+
+    ImageView(const ImageView&) = delete;
+    ImageView& operator=(const ImageView&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that maps the file and parses its header. It fails for the files CarrierLayout does not describe,
+      for 32-bit BMPs whose alpha channel stbi_load may replace and for files that cannot be mapped;
+      those files are loaded as an Image instead.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that decodes the message into the sink. It reads the rows of the longest stego header,
+      then the rows the payload it announces reaches, and decodes the message from them.
+      Return type: boolean.
+    */
+    bool decodeStream(PayloadSink& sink);
+
+    const uint8_t* data = nullptr; //!< A variable that stores the pixels in the mapping, nullptr when they are stored in another layout.
+    size_t size = 0; //!< A variable that stores the value of the image size.
+    int w = 0; //!< A variable that stores the value of the image width.
+    int h = 0; //!< A variable that stores the value of the image height.
+    int channels = 0; //!< A variable that stores the number of channels of the image.
+    int rowsRead = 0; //!< A variable that stores how many rows were read so far.
+
+private:
+    //! A function variable.
+    /*!
+      A function that makes the first rows of the image, enough to hold carrierBytes bytes, available and returns them.
+    */
+    const uint8_t* readRows(uint64_t carrierBytes);
+
+    CarrierLayout layout; //!< A variable that stores the stored pixel layout of the file.
+    uint8_t* mapping = nullptr; //!< A variable that stores the mapping of the whole file.
+    size_t length = 0; //!< A variable that stores the size of the file.
+    std::vector<uint8_t> reordered; //!< A variable that stores the rows read so far when data is nullptr.
+};
+
+#endif //ImageSteganography_IMAGE_VIEW_H
@@ -0,0 +1,555 @@
+//!  An inflate class.
+/*!
+    A class that decodes zlib streams block by block into a history buffer, with a lookup table for short Huffman codes
+    and a canonical walk for the longer ones, and a fast loop for the bulk of compressed blocks.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "Inflate.h"
+
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+}; //!< The shortest match length of every length symbol (257-285).
+static const uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+}; //!< The number of extra bits of every length symbol.
+static const uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+}; //!< The shortest distance of every distance symbol.
+static const uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+}; //!< The number of extra bits of every distance symbol.
+static const uint8_t codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+}; //!< The order the code length code lengths are stored in.
+
+//! A constructor.
+/*!
+  A constructor that stores the source; nothing is read before the first call to read.
+*/
+Inflater::Inflater(const Source& source) : source(source) {
+}
+
+//! A function variable.
+/*!
+  A function that tells whether the stream was corrupt or ended too early.
+  Return type: boolean.
+*/
+bool Inflater::failed() const {
+    return state == STATE::FAILED;
+}
+
+//! A function variable.
+/*!
+  A function that tells whether the final block was decoded completely.
+  Return type: boolean.
+*/
+bool Inflater::finished() const {
+    return state == STATE::DONE;
+}
+
+//! A function variable.
+/*!
+  A function that builds the canonical code. Codes are stored most significant bit first in the bit stream,
+  so the lookup table is indexed by the reversed code, repeated for every value of the bits that follow it.
+  A pair entry is the entry of the first code, joined with the second literal when the bits left in the index
+  hold its whole code.
+  Return type: boolean.
+*/
+bool Inflater::buildHuffman(Huffman& code, const uint8_t* lengths, int count, bool pairs) {
+    memset(code.counts, 0, sizeof(code.counts));
+    memset(code.fast, 0, sizeof(code.fast));
+    for(int s = 0; s < count; ++s) {
+        code.counts[lengths[s]]++;
+    }
+    code.counts[0] = 0;
+
+    int left = 1;
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for(int len = 1; len < 16; ++len) {
+        left = (left << 1) - code.counts[len];
+        if(left < 0) {
+            return false;
+        }
+        if(len < 15) {
+            offsets[len + 1] = offsets[len] + code.counts[len];
+        }
+    }
+    for(int s = 0; s < count; ++s) {
+        if(lengths[s] != 0) {
+            code.symbols[offsets[lengths[s]]++] = (uint16_t)s;
+        }
+    }
+
+    uint32_t next = 0;
+    int index = 0;
+    for(int len = 1; len <= INFLATE_FAST_BITS; ++len) {
+        for(int i = 0; i < code.counts[len]; ++i, ++index, ++next) {
+            uint32_t reversed = 0;
+            for(int b = 0; b < len; ++b) {
+                reversed |= ((next >> b) & 1) << (len - 1 - b);
+            }
+            for(uint32_t j = reversed; j < (1u << INFLATE_FAST_BITS); j += 1u << len) {
+                code.fast[j] = (uint16_t)((len << 9) | code.symbols[index]);
+            }
+        }
+        next <<= 1;
+    }
+#if INFLATE_FAST_LOOP
+    if(pairs) {
+        for(uint32_t j = 0; j < (1u << INFLATE_FAST_BITS); ++j) {
+            uint32_t first = code.fast[j];
+            uint32_t firstBits = first >> 9;
+            uint32_t entry = first == 0 ? 0 : (first & 0x1FF) | (firstBits << 17) | (1u << 22);
+            if(first != 0 && (first & 0x1FF) < 256) {
+                uint32_t second = code.fast[j >> firstBits];
+                uint32_t secondBits = second >> 9;
+                if(second != 0 && (second & 0x1FF) < 256 && firstBits + secondBits <= INFLATE_FAST_BITS) {
+                    entry = (first & 0x1FF) | ((second & 0xFF) << 9) | ((firstBits + secondBits) << 17) | (2u << 22);
+                }
+            }
+            code.pairs[j] = entry;
+        }
+    }
+#else
+    (void)pairs;
+#endif
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that buffers bytes until n bits are available, topping the buffer up to 56 bits while input is at hand.
+  Past the end of the input it buffers zero bytes, so a code near the end of the stream can still be looked up;
+  overrun() tells whether any of them were used.
+*/
+inline void Inflater::needBits(int n) {
+    if(bitCount >= n) {
+        return;
+    }
+    while(bitCount <= 56) {
+        if(inputPos == inputEnd) {
+            if(bitCount >= n) {
+                return;
+            }
+            inputPos = 0;
+            inputEnd = paddingBytes == 0 ? source(input, sizeof(input)) : 0;
+            if(inputEnd == 0) {
+                paddingBytes++;
+                bitCount += 8;
+                continue;
+            }
+        }
+        bits |= (uint64_t)input[inputPos++] << bitCount;
+        bitCount += 8;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that removes n buffered bits and returns them.
+*/
+inline uint32_t Inflater::takeBits(int n) {
+    needBits(n);
+    uint32_t value = (uint32_t)(bits & ((1ull << n) - 1));
+    bits >>= n;
+    bitCount -= n;
+    return value;
+}
+
+//! A function variable.
+/*!
+  A function that tells whether bits beyond the end of the input were used.
+  Return type: boolean.
+*/
+bool Inflater::overrun() const {
+    return bitCount < paddingBytes * 8;
+}
+
+//! A function variable.
+/*!
+  A function that decodes one symbol: short codes come from the lookup table,
+  longer ones are found by walking the code lengths one bit at a time.
+*/
+inline int Inflater::decodeSymbol(const Huffman& code) {
+    needBits(INFLATE_FAST_BITS);
+    uint16_t entry = code.fast[bits & ((1u << INFLATE_FAST_BITS) - 1)];
+    if(entry != 0) {
+        bits >>= entry >> 9;
+        bitCount -= entry >> 9;
+        return entry & 0x1FF;
+    }
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    for(int len = 1; len < 16; ++len) {
+        value |= (int)takeBits(1);
+        int count = code.counts[len];
+        if(value - count < first) {
+            return code.symbols[index + (value - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+//! A function variable.
+/*!
+  A function that reads the code lengths of a dynamic block, run-length coded with a code of its own, and builds its codes.
+  Return type: boolean.
+*/
+bool Inflater::readDynamicCodes() {
+    int literalCount = (int)takeBits(5) + 257;
+    int distanceCount = (int)takeBits(5) + 1;
+    int lengthCount = (int)takeBits(4) + 4;
+    if(literalCount > 286 || distanceCount > 30) {
+        return false;
+    }
+    uint8_t lengths[286 + 30] = {0};
+    for(int i = 0; i < lengthCount; ++i) {
+        lengths[codeLengthOrder[i]] = (uint8_t)takeBits(3);
+    }
+    Huffman lengthCode;
+    if(!buildHuffman(lengthCode, lengths, 19, false)) {
+        return false;
+    }
+
+    memset(lengths, 0, sizeof(lengths));
+    int total = literalCount + distanceCount;
+    for(int i = 0; i < total;) {
+        int symbol = decodeSymbol(lengthCode);
+        if(symbol < 0) {
+            return false;
+        }
+        if(symbol < 16) {
+            lengths[i++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t repeated = 0;
+        int repeat = 0;
+        if(symbol == 16) {
+            if(i == 0) {
+                return false;
+            }
+            repeated = lengths[i - 1];
+            repeat = 3 + (int)takeBits(2);
+        }
+        else if(symbol == 17) {
+            repeat = 3 + (int)takeBits(3);
+        }
+        else {
+            repeat = 11 + (int)takeBits(7);
+        }
+        if(i + repeat > total) {
+            return false;
+        }
+        while(repeat-- > 0) {
+            lengths[i++] = repeated;
+        }
+    }
+    if(lengths[256] == 0) {
+        return false;
+    }
+    return buildHuffman(literals, lengths, literalCount, true)
+           && buildHuffman(distances, lengths + literalCount, distanceCount, false);
+}
+
+//! A function variable.
+/*!
+  A function that reads the block type and sets up the block: the length of an uncompressed block,
+  the fixed codes or the codes of a dynamic block.
+  Return type: boolean.
+*/
+bool Inflater::readBlockHeader() {
+    finalBlock = takeBits(1) != 0;
+    uint32_t type = takeBits(2);
+    if(type == 0) {
+        takeBits(bitCount % 8);
+        uint32_t length = takeBits(16);
+        uint32_t complement = takeBits(16);
+        if((length ^ 0xFFFF) != complement) {
+            return false;
+        }
+        storedRemaining = length;
+        state = STATE::STORED;
+        return true;
+    }
+    if(type == 1) {
+        uint8_t lengths[288 + 30];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        memset(lengths + 288, 5, 30);
+        buildHuffman(literals, lengths, 288, true);
+        buildHuffman(distances, lengths + 288, 30, false);
+        state = STATE::HUFFMAN;
+        return true;
+    }
+    if(type == 2 && readDynamicCodes()) {
+        state = STATE::HUFFMAN;
+        return true;
+    }
+    return false;
+}
+
+//! A function variable.
+/*!
+  A function that copies a match forward. From 16 bytes back on, 16 bytes are copied at a time, each copy reading
+  bytes the ones before wrote; closer repeats copy the pattern from its first occurrence in pieces that double,
+  which stay whole periods of it. Up to 15 bytes past the match may be written.
+*/
+static inline void copyBytes(uint8_t* to, size_t length, size_t distance) {
+    const uint8_t* from = to - distance;
+    if(distance >= 16) {
+        for(size_t i = 0; i < length; i += 16) {
+            memcpy(to + i, from + i, 16);
+        }
+    }
+    else if(distance == 1) {
+        memset(to, from[0], length);
+    }
+    else {
+        size_t done = 0;
+        while(done < length) {
+            size_t count = std::min(done + distance, length - done);
+            memcpy(to + done, from, count);
+            done += count;
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that appends the match to the history. The history always holds the whole stream or at least its last
+  32 KB, so a distance is valid when it does not reach before the start of the history.
+  Return type: boolean.
+*/
+inline bool Inflater::copyMatch(size_t length, size_t distance) {
+    if(distance > historyEnd) {
+        return false;
+    }
+    copyBytes(history + historyEnd, length, distance);
+    historyEnd += length;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that moves the window to the start of the history.
+*/
+void Inflater::slideWindow() {
+    size_t shift = historyEnd - INFLATE_WINDOW_SIZE;
+    memmove(history, history + shift, INFLATE_WINDOW_SIZE);
+    historyEnd -= shift;
+    historyRead -= shift;
+}
+
+#if INFLATE_FAST_LOOP
+//! A function variable.
+/*!
+  A function that decodes with the bit buffer refilled branch-free from an unaligned 64-bit load: the bytes that fit
+  are consumed and at least 56 bits are buffered, enough for a literal pair or a whole match with its extra bits.
+  Bits above the buffered ones come from the next input bytes and are ORed in again, unchanged, by the next refill.
+  Long codes and the last bytes of the input buffer are left to the symbol by symbol path.
+*/
+void Inflater::decodeFast(size_t limit) {
+    const uint64_t mask = (1u << INFLATE_FAST_BITS) - 1;
+    size_t end = historyEnd;
+    while(end < limit && inputEnd - inputPos >= 8) {
+        uint64_t word = 0;
+        memcpy(&word, input + inputPos, 8);
+        bits |= word << bitCount;
+        inputPos += (size_t)(63 - bitCount) >> 3;
+        bitCount |= 56;
+
+        uint32_t entry = literals.pairs[bits & mask];
+        if(entry == 0) {
+            break;
+        }
+        int used = (int)((entry >> 17) & 31);
+        bits >>= used;
+        bitCount -= used;
+        uint32_t symbol = entry & 0x1FF;
+        if(symbol < 256) {
+            history[end++] = (uint8_t)symbol;
+            if((entry >> 22) == 2) {
+                history[end++] = (uint8_t)(entry >> 9);
+            }
+            continue;
+        }
+        if(symbol == 256) {
+            state = finalBlock ? STATE::DONE : STATE::BLOCK_HEADER;
+            break;
+        }
+        symbol -= 257;
+        if(symbol >= 29) {
+            state = STATE::FAILED;
+            break;
+        }
+        int extra = lengthExtra[symbol];
+        size_t length = lengthBase[symbol] + (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        bitCount -= extra;
+
+        int distanceSymbol = 0;
+        uint16_t distanceEntry = distances.fast[bits & mask];
+        if(distanceEntry != 0) {
+            bits >>= distanceEntry >> 9;
+            bitCount -= distanceEntry >> 9;
+            distanceSymbol = distanceEntry & 0x1FF;
+        }
+        else {
+            distanceSymbol = decodeSymbol(distances);
+        }
+        if(distanceSymbol < 0 || distanceSymbol >= 30) {
+            state = STATE::FAILED;
+            break;
+        }
+        extra = distanceExtra[distanceSymbol];
+        size_t distance = distanceBase[distanceSymbol] + (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        bitCount -= extra;
+        if(distance > end) {
+            state = STATE::FAILED;
+            break;
+        }
+        copyBytes(history + end, length, distance);
+        end += length;
+    }
+    historyEnd = end;
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that runs the block state machine. Every step adds at most one match to the history, so it never
+  writes more than INFLATE_SLACK bytes past the limit. Stored blocks are copied from the input buffer.
+*/
+void Inflater::decode() {
+    const size_t limit = INFLATE_WINDOW_SIZE + INFLATE_CHUNK_SIZE;
+    while(historyEnd < limit) {
+        if(state == STATE::ZLIB_HEADER) {
+            uint32_t method = takeBits(8);
+            uint32_t flags = takeBits(8);
+            if((method & 0x0F) != 8 || (method >> 4) > 7 || ((method << 8) | flags) % 31 != 0 || (flags & 0x20) != 0) {
+                state = STATE::FAILED;
+                return;
+            }
+            state = STATE::BLOCK_HEADER;
+        }
+        else if(state == STATE::BLOCK_HEADER) {
+            if(!readBlockHeader() || overrun()) {
+                state = STATE::FAILED;
+                return;
+            }
+        }
+        else if(state == STATE::STORED) {
+            size_t count = std::min(storedRemaining, limit - historyEnd);
+            storedRemaining -= count;
+            while(count > 0 && bitCount >= 8) {
+                history[historyEnd++] = (uint8_t)bits;
+                bits >>= 8;
+                bitCount -= 8;
+                count--;
+            }
+            if(overrun()) {
+                state = STATE::FAILED;
+                return;
+            }
+            if(count > 0) {
+                bits = 0;
+            }
+            while(count > 0) {
+                if(inputPos == inputEnd) {
+                    inputPos = 0;
+                    inputEnd = source(input, sizeof(input));
+                    if(inputEnd == 0) {
+                        state = STATE::FAILED;
+                        return;
+                    }
+                }
+                size_t piece = std::min(count, inputEnd - inputPos);
+                memcpy(history + historyEnd, input + inputPos, piece);
+                historyEnd += piece;
+                inputPos += piece;
+                count -= piece;
+            }
+            if(storedRemaining == 0) {
+                state = finalBlock ? STATE::DONE : STATE::BLOCK_HEADER;
+            }
+        }
+        else if(state == STATE::HUFFMAN) {
+#if INFLATE_FAST_LOOP
+            decodeFast(limit);
+            if(state != STATE::HUFFMAN || historyEnd >= limit) {
+                continue;
+            }
+#endif
+            int symbol = decodeSymbol(literals);
+            if(symbol < 0 || overrun()) {
+                state = STATE::FAILED;
+                return;
+            }
+            if(symbol < 256) {
+                history[historyEnd++] = (uint8_t)symbol;
+                continue;
+            }
+            if(symbol == 256) {
+                state = finalBlock ? STATE::DONE : STATE::BLOCK_HEADER;
+                continue;
+            }
+            symbol -= 257;
+            if(symbol >= 29) {
+                state = STATE::FAILED;
+                return;
+            }
+            size_t length = lengthBase[symbol] + takeBits(lengthExtra[symbol]);
+            int distanceSymbol = decodeSymbol(distances);
+            if(distanceSymbol < 0 || distanceSymbol >= 30) {
+                state = STATE::FAILED;
+                return;
+            }
+            size_t distance = distanceBase[distanceSymbol] + takeBits(distanceExtra[distanceSymbol]);
+            if(overrun() || !copyMatch(length, distance)) {
+                state = STATE::FAILED;
+                return;
+            }
+        }
+        else {
+            return;
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that hands out the decoded bytes of the history and decodes the next chunk when they are all read.
+  Bytes decoded before corrupt data are still handed out before the short count.
+*/
+size_t Inflater::read(uint8_t* out, size_t size) {
+    size_t done = 0;
+    while(done < size) {
+        if(historyRead == historyEnd) {
+            if(state == STATE::DONE || state == STATE::FAILED) {
+                break;
+            }
+            if(historyEnd >= INFLATE_WINDOW_SIZE + INFLATE_CHUNK_SIZE) {
+                slideWindow();
+            }
+            decode();
+            continue;
+        }
+        size_t count = std::min(historyEnd - historyRead, size - done);
+        memcpy(out + done, history + historyRead, count);
+        historyRead += count;
+        done += count;
+    }
+    return done;
+}
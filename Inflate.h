@@ -0,0 +1,192 @@
+//!  An inflate class.
+/*!
+  A class that decompresses a zlib stream (RFC 1950/1951) incrementally: compressed bytes are pulled from a source
+  function when they are needed, and the output is produced in pieces of any size the caller asks for.
+  Blocks are decoded ahead into a history buffer, the 32 KB window followed by up to INFLATE_CHUNK_SIZE new bytes,
+  so matches are plain forward copies; read() hands out the new bytes. Memory use is fixed (the history buffer and
+  a 64 KB input buffer), whatever the size of the stream.
+  With INFLATE_FAST_LOOP (the default on little-endian targets, build with -DINFLATE_FAST_LOOP=0 to leave it out) compressed blocks are decoded
+  by a loop that refills the bit buffer a 64-bit word at a time, decodes two literals with one table lookup when
+  their codes fit in it and copies matches 16 bytes at a time; the output is the same byte for byte.
+*/
+
+#ifndef ImageSteganography_INFLATE_H
+#define ImageSteganography_INFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "CpuFeatures.h"
+
+#define INFLATE_WINDOW_SIZE 32768
+#define INFLATE_INPUT_SIZE 65536
+#define INFLATE_CHUNK_SIZE 65536
+#define INFLATE_MAX_MATCH 258
+#define INFLATE_SLACK (INFLATE_MAX_MATCH + 16) //!< The bytes the history buffer has past its limit: one match, plus the overshoot of a 16-byte copy.
+#define INFLATE_FAST_BITS 11
+
+#ifndef INFLATE_FAST_LOOP
+#ifdef CPU_LITTLE_ENDIAN
+#define INFLATE_FAST_LOOP 1
+#else
+#define INFLATE_FAST_LOOP 0 //!< The fast loop refills the bit buffer with a little-endian load.
+#endif
+#endif
+
+//! A class.
+/*! A class that inflates a zlib stream pulled from a source function. */
+class Inflater {
+public:
+    //! A type.
+    /*! A function that fills the buffer with up to size compressed bytes and returns how many it stored, 0 at the end. */
+    typedef std::function<size_t(uint8_t* buffer, size_t size)> Source;
+
+    //! A constructor.
+    /*!
+      A constructor that takes the source of the compressed bytes, starting with the zlib header.
+    */
+    explicit Inflater(const Source& source);
+
+    //! A function variable.
+    /*!
+      A function that produces up to size decompressed bytes and returns how many it produced.
+      It returns less than size only at the end of the stream or on corrupt data, which failed() tells apart.
+    */
+    size_t read(uint8_t* out, size_t size);
+
+    //! A function variable.
+    /*!
+      A function that tells whether the stream was corrupt or ended too early.
+      Return type: boolean.
+    */
+    bool failed() const;
+
+    //! A function variable.
+    /*!
+      A function that tells whether the final block was decoded completely.
+      Return type: boolean.
+    */
+    bool finished() const;
+
+private:
+    //! An enum.
+    /*! An enum that stores what the inflater decodes next. */
+    enum class STATE {
+        ZLIB_HEADER, /*!< Enum value ZLIB_HEADER. */
+        BLOCK_HEADER, /*!< Enum value BLOCK_HEADER. */
+        STORED, /*!< Enum value STORED, inside an uncompressed block. */
+        HUFFMAN, /*!< Enum value HUFFMAN, inside a compressed block. */
+        DONE, /*!< Enum value DONE. */
+        FAILED /*!< Enum value FAILED. */
+    };
+
+    //! A structure.
+    /*!
+      A structure that stores a canonical Huffman code: a lookup table for codes up to INFLATE_FAST_BITS bits
+      (length << 9 | symbol, 0 for longer codes) and the code counts and sorted symbols for the longer ones.
+      The fast loop looks literal/length codes up in a second table whose entries hold one symbol or two literals
+      (first symbol | second literal << 9 | bits of both << 17 | number of symbols << 22, 0 for longer codes).
+    */
+    struct Huffman {
+        uint16_t fast[1 << INFLATE_FAST_BITS]; //!< A variable that stores the lookup table indexed by the next bits.
+#if INFLATE_FAST_LOOP
+        uint32_t pairs[1 << INFLATE_FAST_BITS]; //!< A variable that stores the table of one symbol or two literals.
+#endif
+        uint16_t counts[16]; //!< A variable that stores how many codes every length has.
+        uint16_t symbols[288]; //!< A variable that stores the symbols ordered by code.
+    };
+
+    //! A function variable.
+    /*!
+      A function that builds the code from the code length of every symbol, with the table of literal pairs if asked.
+      Return type: boolean, false for an over-subscribed code.
+    */
+    static bool buildHuffman(Huffman& code, const uint8_t* lengths, int count, bool pairs);
+
+    //! A function variable.
+    /*!
+      A function that makes sure at least n bits are buffered, padding with zero bytes past the end of the input.
+    */
+    void needBits(int n);
+
+    //! A function variable.
+    /*!
+      A function that removes n buffered bits and returns them.
+    */
+    uint32_t takeBits(int n);
+
+    //! A function variable.
+    /*!
+      A function that decodes one symbol with the code, -1 for an invalid code.
+    */
+    int decodeSymbol(const Huffman& code);
+
+    //! A function variable.
+    /*!
+      A function that reads the block type and, for compressed blocks, the Huffman codes.
+      Return type: boolean.
+    */
+    bool readBlockHeader();
+
+    //! A function variable.
+    /*!
+      A function that reads the code lengths of a dynamic block and builds its codes.
+      Return type: boolean.
+    */
+    bool readDynamicCodes();
+
+    //! A function variable.
+    /*!
+      A function that appends a match of length bytes starting distance bytes back to the history.
+      Return type: boolean, false for a distance before the start of the stream.
+    */
+    bool copyMatch(size_t length, size_t distance);
+
+    //! A function variable.
+    /*!
+      A function that moves the last 32 KB of the history to its start, once every byte after them was read.
+    */
+    void slideWindow();
+
+    //! A function variable.
+    /*!
+      A function that runs the block state machine until the history holds INFLATE_CHUNK_SIZE bytes after the window,
+      or the stream ended.
+    */
+    void decode();
+
+#if INFLATE_FAST_LOOP
+    //! A function variable.
+    /*!
+      A function that decodes symbols of a compressed block while at least 8 input bytes are buffered and the history
+      has room for a match, and stops at the end of the block, on corrupt data or at the limit.
+    */
+    void decodeFast(size_t limit);
+#endif
+
+    //! A function variable.
+    /*!
+      A function that tells whether bits beyond the end of the input were used.
+      Return type: boolean.
+    */
+    bool overrun() const;
+
+    Source source; //!< A variable that stores the source of the compressed bytes.
+    STATE state = STATE::ZLIB_HEADER; //!< A variable that stores what is decoded next.
+    bool finalBlock = false; //!< A variable that tells whether the current block is the last one.
+    uint64_t bits = 0; //!< A variable that stores the buffered bits, the next one in bit 0.
+    int bitCount = 0; //!< A variable that stores how many bits are buffered.
+    int paddingBytes = 0; //!< A variable that stores how many zero bytes were buffered past the end of the input.
+    size_t inputPos = 0; //!< A variable that stores the next unread byte of the input buffer.
+    size_t inputEnd = 0; //!< A variable that stores the end of the valid bytes of the input buffer.
+    size_t storedRemaining = 0; //!< A variable that stores the bytes left in the current uncompressed block.
+    size_t historyRead = 0; //!< A variable that stores the first byte of the history read() has not handed out.
+    size_t historyEnd = 0; //!< A variable that stores the end of the decoded bytes of the history.
+    Huffman literals; //!< A variable that stores the literal/length code of the current block.
+    Huffman distances; //!< A variable that stores the distance code of the current block.
+    uint8_t history[INFLATE_WINDOW_SIZE + INFLATE_CHUNK_SIZE + INFLATE_SLACK]; //!< A variable that stores the last 32 KB of output and the bytes decoded after them.
+    uint8_t input[INFLATE_INPUT_SIZE]; //!< A variable that stores compressed bytes pulled from the source.
+};
+
+#endif //ImageSteganography_INFLATE_H
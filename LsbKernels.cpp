@@ -0,0 +1,854 @@
+//!  LSB kernels.
+/*!
+    Scalar reference and SIMD implementations of the LSB embedding and extraction kernels.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "LsbKernels.h"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+//! A function variable.
+/*!
+  A function that reverses the bit order inside every byte of a 64-bit word.
+  Movemask, pext and mask registers put the first carrier byte into bit 0 while the payload stores it in bit 7.
+*/
+static inline uint64_t reverseBitsInBytes(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return v;
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload one bit at a time.
+  Bit 7 of every payload byte goes to the first of its 8 carrier bytes, bit 0 to the last one.
+*/
+void embedBitsScalar(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    for(size_t i = 0; i < payloadSize; ++i) {
+        for(int bit = 0; bit < 8; ++bit) {
+            carrier[i * 8 + bit] &= 0xFE;
+            carrier[i * 8 + bit] |= (payload[i] >> (7 - bit)) & 1;
+        }
+    }
+}
+
+#ifdef CPU_LITTLE_ENDIAN
+//! A structure.
+/*! A structure that stores the 256-entry table spreading the bits of a byte over the LSBs of a 64-bit word. */
+struct SpreadTable {
+    uint64_t words[256]; //!< Bit 7 of the index in the LSB of byte 0, bit 0 in the LSB of byte 7.
+
+    SpreadTable() {
+        for(int value = 0; value < 256; ++value) {
+            uint64_t word = 0;
+            for(int bit = 0; bit < 8; ++bit) {
+                word |= (uint64_t)((value >> (7 - bit)) & 1) << (8 * bit);
+            }
+            words[value] = word;
+        }
+    }
+};
+
+static const SpreadTable spreadTable; //!< The spread table of the SWAR kernels.
+#endif
+
+//! A function variable.
+/*!
+  A function that embeds the payload 64 bits at a time without any vector or BMI2 instruction.
+  Every payload byte selects its spread carrier LSBs from the table and is merged with one and-or.
+  The table puts the first carrier byte in the low 8 bits of a word, so big-endian targets use the scalar kernel.
+*/
+void embedBitsSWAR(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+#ifdef CPU_LITTLE_ENDIAN
+    const uint64_t keepMask = 0xFEFEFEFEFEFEFEFEULL;
+    for(size_t i = 0; i < payloadSize; ++i) {
+        uint64_t word;
+        memcpy(&word, carrier + i * 8, sizeof(word));
+        word = (word & keepMask) | spreadTable.words[payload[i]];
+        memcpy(carrier + i * 8, &word, sizeof(word));
+    }
+#else
+    embedBitsScalar(carrier, payload, payloadSize);
+#endif
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload 64 bits at a time without any vector or BMI2 instruction.
+  The 8 LSBs of a carrier word are collected into the top byte with one multiplication,
+  whose partial products land on distinct bits, so no carries disturb the result.
+  The multiplier expects the first carrier byte in the low 8 bits, so big-endian targets use the scalar kernel.
+*/
+void extractBitsSWAR(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+#ifdef CPU_LITTLE_ENDIAN
+    const uint64_t lsbMask = 0x0101010101010101ULL;
+    const uint64_t gather = 0x8040201008040201ULL;
+    for(size_t i = 0; i < payloadSize; ++i) {
+        uint64_t word;
+        memcpy(&word, carrier + i * 8, sizeof(word));
+        payload[i] = (uint8_t)(((word & lsbMask) * gather) >> 56);
+    }
+#else
+    extractBitsScalar(payload, carrier, payloadSize);
+#endif
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that embeds the payload with SSE2.
+  Every payload byte is broadcast to 8 lanes with unpacks, tested against a per-lane bit selector
+  and merged into the cleared carrier LSBs.
+*/
+CPU_TARGET("sse2")
+void embedBitsSSE2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    const __m128i bitSelect = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i keepMask = _mm_set1_epi8((char)0xFE);
+    const __m128i one = _mm_set1_epi8(1);
+
+    size_t i = 0;
+    for(; i + 4 <= payloadSize; i += 4) {
+        uint32_t quad;
+        memcpy(&quad, payload + i, sizeof(quad));
+        __m128i v = _mm_cvtsi32_si128((int)quad);
+        v = _mm_unpacklo_epi8(v, v);
+        v = _mm_unpacklo_epi16(v, v);
+        __m128i lo = _mm_unpacklo_epi32(v, v);
+        __m128i hi = _mm_unpackhi_epi32(v, v);
+        lo = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(lo, bitSelect), bitSelect), one);
+        hi = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(hi, bitSelect), bitSelect), one);
+
+        __m128i* dst = (__m128i*)(carrier + i * 8);
+        __m128i c0 = _mm_loadu_si128(dst);
+        __m128i c1 = _mm_loadu_si128(dst + 1);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(c0, keepMask), lo));
+        _mm_storeu_si128(dst + 1, _mm_or_si128(_mm_and_si128(c1, keepMask), hi));
+    }
+    embedBitsScalar(carrier + i * 8, payload + i, payloadSize - i);
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload with AVX2.
+  Four payload bytes are broadcast into both 128-bit lanes and spread to 8 lanes each with a single shuffle.
+*/
+CPU_TARGET("avx2")
+void embedBitsAVX2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bitSelect = _mm256_set1_epi64x((long long)0x0102040810204080ULL);
+    const __m256i keepMask = _mm256_set1_epi8((char)0xFE);
+    const __m256i one = _mm256_set1_epi8(1);
+
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        uint32_t quad0, quad1;
+        memcpy(&quad0, payload + i, sizeof(quad0));
+        memcpy(&quad1, payload + i + 4, sizeof(quad1));
+        __m256i v0 = _mm256_shuffle_epi8(_mm256_set1_epi32((int)quad0), spread);
+        __m256i v1 = _mm256_shuffle_epi8(_mm256_set1_epi32((int)quad1), spread);
+        v0 = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v0, bitSelect), bitSelect), one);
+        v1 = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v1, bitSelect), bitSelect), one);
+
+        __m256i* dst = (__m256i*)(carrier + i * 8);
+        __m256i c0 = _mm256_loadu_si256(dst);
+        __m256i c1 = _mm256_loadu_si256(dst + 1);
+        _mm256_storeu_si256(dst, _mm256_or_si256(_mm256_and_si256(c0, keepMask), v0));
+        _mm256_storeu_si256(dst + 1, _mm256_or_si256(_mm256_and_si256(c1, keepMask), v1));
+    }
+    embedBitsSSE2(carrier + i * 8, payload + i, payloadSize - i);
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that extracts the payload one bit at a time, shifting every carrier LSB into the output byte.
+*/
+void extractBitsScalar(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    for(size_t i = 0; i < payloadSize; ++i) {
+        uint8_t byte = 0;
+        for(int bit = 0; bit < 8; ++bit) {
+            byte = (uint8_t)((byte << 1) | (carrier[i * 8 + bit] & 1));
+        }
+        payload[i] = byte;
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that extracts the payload with SSE2.
+  A 16-bit shift by 7 moves the LSB of every byte into its sign bit, pmovmskb collects the sign bits
+  and the bit order of each byte is reversed to get the MSB-first payload bytes.
+*/
+CPU_TARGET("sse2")
+void extractBitsSSE2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    size_t i = 0;
+    for(; i + 4 <= payloadSize; i += 4) {
+        const __m128i* src = (const __m128i*)(carrier + i * 8);
+        uint32_t lo = (uint32_t)_mm_movemask_epi8(_mm_slli_epi16(_mm_loadu_si128(src), 7));
+        uint32_t hi = (uint32_t)_mm_movemask_epi8(_mm_slli_epi16(_mm_loadu_si128(src + 1), 7));
+        uint32_t quad = (uint32_t)reverseBitsInBytes(lo | (hi << 16));
+        memcpy(payload + i, &quad, sizeof(quad));
+    }
+    extractBitsScalar(payload + i, carrier + i * 8, payloadSize - i);
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload with AVX2.
+  Carrier bytes are reversed inside each group of 8 with vpshufb first,
+  so the vpmovmskb result already holds the payload bytes in MSB-first order.
+*/
+CPU_TARGET("avx2")
+void extractBitsAVX2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        const __m256i* src = (const __m256i*)(carrier + i * 8);
+        __m256i v0 = _mm256_slli_epi16(_mm256_shuffle_epi8(_mm256_loadu_si256(src), reverse), 7);
+        __m256i v1 = _mm256_slli_epi16(_mm256_shuffle_epi8(_mm256_loadu_si256(src + 1), reverse), 7);
+        uint32_t quad0 = (uint32_t)_mm256_movemask_epi8(v0);
+        uint32_t quad1 = (uint32_t)_mm256_movemask_epi8(v1);
+        memcpy(payload + i, &quad0, sizeof(quad0));
+        memcpy(payload + i + 4, &quad1, sizeof(quad1));
+    }
+    extractBitsSSE2(payload + i, carrier + i * 8, payloadSize - i);
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload with BMI2, 8 payload bytes per 64-bit load.
+  The bit order of the 8 bytes is reversed at once, then every byte is deposited
+  into the LSB positions of its 64-bit carrier word with pdep.
+*/
+CPU_TARGET("bmi2")
+void embedBitsBMI2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    const uint64_t lsbMask = 0x0101010101010101ULL;
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        uint64_t bits;
+        memcpy(&bits, payload + i, sizeof(bits));
+        bits = reverseBitsInBytes(bits);
+        for(int j = 0; j < 8; ++j) {
+            uint64_t word;
+            memcpy(&word, carrier + (i + j) * 8, sizeof(word));
+            word = (word & ~lsbMask) | _pdep_u64(bits >> (8 * j), lsbMask);
+            memcpy(carrier + (i + j) * 8, &word, sizeof(word));
+        }
+    }
+    for(; i < payloadSize; ++i) {
+        uint64_t word;
+        memcpy(&word, carrier + i * 8, sizeof(word));
+        word = (word & ~lsbMask) | _pdep_u64(reverseBitsInBytes(payload[i]), lsbMask);
+        memcpy(carrier + i * 8, &word, sizeof(word));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload with BMI2, 8 payload bytes per 64-bit store.
+  pext gathers the LSBs of every 64-bit carrier word and the bit order of the 8 bytes is reversed at once.
+*/
+CPU_TARGET("bmi2")
+void extractBitsBMI2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    const uint64_t lsbMask = 0x0101010101010101ULL;
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        uint64_t bits = 0;
+        for(int j = 0; j < 8; ++j) {
+            uint64_t word;
+            memcpy(&word, carrier + (i + j) * 8, sizeof(word));
+            bits |= _pext_u64(word, lsbMask) << (8 * j);
+        }
+        bits = reverseBitsInBytes(bits);
+        memcpy(payload + i, &bits, sizeof(bits));
+    }
+    for(; i < payloadSize; ++i) {
+        uint64_t word;
+        memcpy(&word, carrier + i * 8, sizeof(word));
+        payload[i] = (uint8_t)reverseBitsInBytes(_pext_u64(word, lsbMask));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload with AVX-512BW.
+  8 payload bytes with reversed bit order form a 64-bit mask that writes a one into the selected carrier lanes.
+*/
+CPU_TARGET("avx512f,avx512bw")
+void embedBitsAVX512BW(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    const __m512i keepMask = _mm512_set1_epi8((char)0xFE);
+    const __m512i one = _mm512_set1_epi8(1);
+
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        uint64_t word;
+        memcpy(&word, payload + i, sizeof(word));
+        __mmask64 bits = (__mmask64)reverseBitsInBytes(word);
+        __m512i c = _mm512_loadu_si512(carrier + i * 8);
+        c = _mm512_or_si512(_mm512_and_si512(c, keepMask), _mm512_maskz_mov_epi8(bits, one));
+        _mm512_storeu_si512(carrier + i * 8, c);
+    }
+    embedBitsAVX2(carrier + i * 8, payload + i, payloadSize - i);
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload with AVX-512BW.
+  vptestmb gathers 64 carrier LSBs into a mask register and the bit order is reversed afterwards.
+*/
+CPU_TARGET("avx512f,avx512bw")
+void extractBitsAVX512BW(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    const __m512i one = _mm512_set1_epi8(1);
+
+    size_t i = 0;
+    for(; i + 8 <= payloadSize; i += 8) {
+        __mmask64 bits = _mm512_test_epi8_mask(_mm512_loadu_si512(carrier + i * 8), one);
+        uint64_t word = reverseBitsInBytes((uint64_t)bits);
+        memcpy(payload + i, &word, sizeof(word));
+    }
+    extractBitsAVX2(payload + i, carrier + i * 8, payloadSize - i);
+}
+#endif
+
+//! A structure.
+/*! A structure that stores the instruction set and the embed and extract kernels bound to it. */
+struct LsbKernelTable {
+    InstructionSet isa; //!< The instruction set the kernels were built for.
+    void (*embed)(uint8_t*, const uint8_t*, size_t); //!< The embedding kernel.
+    void (*extract)(uint8_t*, const uint8_t*, size_t); //!< The extraction kernel.
+    bool shuffles; //!< Whether the channel-mask kernels may use pshufb.
+};
+
+//! A function variable.
+/*!
+  A function that returns the kernels of the instruction set.
+*/
+static LsbKernelTable bindLsbKernels(InstructionSet isa) {
+    switch(isa) {
+#ifdef CPU_FEATURES_X86
+        case InstructionSet::SSE2:
+            return { isa, embedBitsSSE2, extractBitsSSE2, false };
+        case InstructionSet::SSSE3:
+            return { isa, embedBitsSSE2, extractBitsSSE2, true };
+        case InstructionSet::AVX2:
+            return { isa, embedBitsAVX2, extractBitsAVX2, true };
+        case InstructionSet::BMI2:
+            return { isa, embedBitsBMI2, extractBitsBMI2, true };
+        case InstructionSet::AVX512BW:
+            return { isa, embedBitsAVX512BW, extractBitsAVX512BW, true };
+#endif
+        case InstructionSet::SWAR:
+            return { isa, embedBitsSWAR, extractBitsSWAR, false };
+        default:
+            return { InstructionSet::SCALAR, embedBitsScalar, extractBitsScalar, false };
+    }
+}
+
+//! A function variable.
+/*!
+  A function that picks the instruction set at startup.
+  STEGO_ISA forces a specific one, so every kernel can be tested on one machine; otherwise the CPU is probed.
+*/
+static InstructionSet startupInstructionSet() {
+    const char* forced = getenv("STEGO_ISA");
+    if(forced != nullptr && forced[0] != '\0') {
+        InstructionSet isa;
+        if(!parseInstructionSet(forced, isa)) {
+            fprintf(stderr, "Unknown STEGO_ISA value %s, using CPU detection\n", forced);
+        }
+        else if(!isInstructionSetSupported(isa)) {
+            fprintf(stderr, "STEGO_ISA=%s is not supported by this CPU, using CPU detection\n", forced);
+        }
+        else {
+            return isa;
+        }
+    }
+    return detectInstructionSet();
+}
+
+static LsbKernelTable lsbKernels = bindLsbKernels(startupInstructionSet()); //!< The kernels behind embedBits and extractBits.
+
+//! A function variable.
+/*!
+  A function that embeds the payload with the kernel bound by the runtime dispatch.
+*/
+void embedBits(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    lsbKernels.embed(carrier, payload, payloadSize);
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload with the kernel bound by the runtime dispatch.
+*/
+void extractBits(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    lsbKernels.extract(payload, carrier, payloadSize);
+}
+
+//! A function variable.
+/*!
+  A function that returns the instruction set embedBits and extractBits are bound to.
+*/
+InstructionSet activeInstructionSet() {
+    return lsbKernels.isa;
+}
+
+//! A function variable.
+/*!
+  A function that binds embedBits and extractBits to the kernels of the given instruction set.
+  Return type: boolean.
+*/
+bool forceInstructionSet(InstructionSet isa) {
+    if(!isInstructionSetSupported(isa)) {
+        return false;
+    }
+    lsbKernels = bindLsbKernels(isa);
+    return true;
+}
+
+//! A structure.
+/*!
+  A structure that stores the group layout of a K-bit kernel: the smallest number of payload bytes
+  that fills a whole number of carrier bytes (1 byte for K = 1, 2, 4 and 3 bytes for K = 3).
+*/
+template<int K>
+struct PackedBitsLayout {
+    static const int groupBytes = K == 3 ? 3 : 1; //!< Payload bytes per group.
+    static const int groupCarriers = groupBytes * 8 / K; //!< Carrier bytes per group.
+    static const uint8_t keepMask = (uint8_t)(0xFF << K); //!< The carrier bits that are left untouched.
+    static const uint32_t valueMask = (1u << K) - 1; //!< The carrier bits that hold the payload.
+};
+
+//! A function variable.
+/*!
+  A function that spreads one group of payload bytes over the carrier bytes, K bits per carrier byte.
+*/
+template<int K>
+static inline void embedPackedGroup(uint8_t* carrier, const uint8_t* group, int carriers) {
+    typedef PackedBitsLayout<K> Layout;
+    uint32_t bits = 0;
+    for(int b = 0; b < Layout::groupBytes; ++b) {
+        bits = (bits << 8) | group[b];
+    }
+    for(int j = 0; j < carriers; ++j) {
+        uint32_t value = (bits >> (Layout::groupBytes * 8 - K * (j + 1))) & Layout::valueMask;
+        carrier[j] = (uint8_t)((carrier[j] & Layout::keepMask) | value);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload K bits per carrier byte, one group at a time.
+*/
+template<int K>
+static void embedPackedBits(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    typedef PackedBitsLayout<K> Layout;
+    size_t groups = payloadSize / Layout::groupBytes;
+    for(size_t g = 0; g < groups; ++g) {
+        embedPackedGroup<K>(carrier + g * Layout::groupCarriers, payload + g * Layout::groupBytes, Layout::groupCarriers);
+    }
+    size_t rest = payloadSize - groups * Layout::groupBytes;
+    if(rest != 0) {
+        uint8_t tail[Layout::groupBytes] = {0};
+        memcpy(tail, payload + groups * Layout::groupBytes, rest);
+        embedPackedGroup<K>(carrier + groups * Layout::groupCarriers, tail, (int)((rest * 8 + K - 1) / K));
+    }
+}
+
+template<>
+void embedPackedBits<1>(uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    embedBits(carrier, payload, payloadSize);
+}
+
+//! A function variable.
+/*!
+  A function that rebuilds one group of payload bytes from the carrier bytes, K bits per carrier byte.
+*/
+template<int K>
+static inline void extractPackedGroup(uint8_t* group, const uint8_t* carrier, int carriers) {
+    typedef PackedBitsLayout<K> Layout;
+    uint32_t bits = 0;
+    for(int j = 0; j < carriers; ++j) {
+        bits = (bits << K) | (carrier[j] & Layout::valueMask);
+    }
+    bits <<= K * (Layout::groupCarriers - carriers);
+    for(int b = 0; b < Layout::groupBytes; ++b) {
+        group[b] = (uint8_t)(bits >> (8 * (Layout::groupBytes - 1 - b)));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload K bits per carrier byte, one group at a time.
+*/
+template<int K>
+static void extractPackedBits(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    typedef PackedBitsLayout<K> Layout;
+    size_t groups = payloadSize / Layout::groupBytes;
+    for(size_t g = 0; g < groups; ++g) {
+        extractPackedGroup<K>(payload + g * Layout::groupBytes, carrier + g * Layout::groupCarriers, Layout::groupCarriers);
+    }
+    size_t rest = payloadSize - groups * Layout::groupBytes;
+    if(rest != 0) {
+        uint8_t tail[Layout::groupBytes];
+        extractPackedGroup<K>(tail, carrier + groups * Layout::groupCarriers, (int)((rest * 8 + K - 1) / K));
+        memcpy(payload + groups * Layout::groupBytes, tail, rest);
+    }
+}
+
+template<>
+void extractPackedBits<1>(uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    extractBits(payload, carrier, payloadSize);
+}
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes hold payloadSize bytes at bitsPerChannel bits per carrier byte.
+*/
+size_t carrierBytesForPayload(int bitsPerChannel, size_t payloadSize) {
+    return (payloadSize * 8 + bitsPerChannel - 1) / bitsPerChannel;
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload with the kernel instantiated for bitsPerChannel.
+*/
+void embedBitsPerChannel(int bitsPerChannel, uint8_t* carrier, const uint8_t* payload, size_t payloadSize) {
+    switch(bitsPerChannel) {
+        case 1:
+            embedPackedBits<1>(carrier, payload, payloadSize);
+            break;
+        case 2:
+            embedPackedBits<2>(carrier, payload, payloadSize);
+            break;
+        case 3:
+            embedPackedBits<3>(carrier, payload, payloadSize);
+            break;
+        case 4:
+            embedPackedBits<4>(carrier, payload, payloadSize);
+            break;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload with the kernel instantiated for bitsPerChannel.
+*/
+void extractBitsPerChannel(int bitsPerChannel, uint8_t* payload, const uint8_t* carrier, size_t payloadSize) {
+    switch(bitsPerChannel) {
+        case 1:
+            extractPackedBits<1>(payload, carrier, payloadSize);
+            break;
+        case 2:
+            extractPackedBits<2>(payload, carrier, payloadSize);
+            break;
+        case 3:
+            extractPackedBits<3>(payload, carrier, payloadSize);
+            break;
+        case 4:
+            extractPackedBits<4>(payload, carrier, payloadSize);
+            break;
+    }
+}
+
+//! A structure.
+/*!
+  A structure that stores the shuffle tables of a channel mask for a block of 16 pixels.
+  A block of 16 pixels is `channels` vectors of 16 bytes; its selected bytes are gathered into
+  `selected` contiguous vectors, run through the dense kernel and scattered back.
+*/
+struct ChannelShuffle {
+    int selected = 0; //!< The number of selected channels per pixel.
+    uint8_t offsets[64]; //!< The block offsets of the selected bytes, in carrier order.
+    alignas(16) uint8_t gather[4][4][16]; //!< pshufb controls that move bytes of input vector [i] into output vector [o], indexed [o][i].
+    alignas(16) uint8_t scatter[4][4][16]; //!< pshufb controls that move bytes of gathered vector [o] back into input vector [i], indexed [i][o].
+    alignas(16) uint8_t select[4][16]; //!< 0xFF on the selected lanes of input vector [i].
+};
+
+//! A function variable.
+/*!
+  A function that builds the shuffle tables for the channel count and mask.
+*/
+static void buildChannelShuffle(ChannelShuffle& shuffle, int channels, uint8_t channelMask) {
+    memset(shuffle.gather, 0x80, sizeof(shuffle.gather));
+    memset(shuffle.scatter, 0x80, sizeof(shuffle.scatter));
+    memset(shuffle.select, 0, sizeof(shuffle.select));
+    int n = 0;
+    for(int pixel = 0; pixel < 16; ++pixel) {
+        for(int channel = 0; channel < channels; ++channel) {
+            if(((channelMask >> channel) & 1) == 0) {
+                continue;
+            }
+            int src = pixel * channels + channel;
+            shuffle.offsets[n] = (uint8_t)src;
+            shuffle.gather[n / 16][src / 16][n % 16] = (uint8_t)(src % 16);
+            shuffle.scatter[src / 16][n / 16][src % 16] = (uint8_t)(n % 16);
+            shuffle.select[src / 16][src % 16] = 0xFF;
+            ++n;
+        }
+    }
+    shuffle.selected = n / 16;
+}
+
+//! A function variable.
+/*!
+  A function that gathers the selected bytes of a block of 16 pixels with the offset table.
+*/
+template<int C>
+static void gatherBlockPortable(const ChannelShuffle& shuffle, const uint8_t* block, uint8_t* scratch) {
+    for(int j = 0; j < shuffle.selected * 16; ++j) {
+        scratch[j] = block[shuffle.offsets[j]];
+    }
+}
+
+//! A function variable.
+/*!
+  A function that scatters the gathered bytes back into a block of 16 pixels with the offset table.
+*/
+template<int C>
+static void scatterBlockPortable(const ChannelShuffle& shuffle, const uint8_t* scratch, uint8_t* block) {
+    for(int j = 0; j < shuffle.selected * 16; ++j) {
+        block[shuffle.offsets[j]] = scratch[j];
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that gathers the selected bytes of a block of 16 pixels with pshufb.
+  Every gathered vector is the OR of one shuffle per input vector.
+*/
+template<int C>
+CPU_TARGET("ssse3")
+static void gatherBlockShuffle(const ChannelShuffle& shuffle, const uint8_t* block, uint8_t* scratch) {
+    __m128i in[C];
+    for(int i = 0; i < C; ++i) {
+        in[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+    }
+    for(int o = 0; o < shuffle.selected; ++o) {
+        __m128i gathered = _mm_setzero_si128();
+        for(int i = 0; i < C; ++i) {
+            __m128i control = _mm_load_si128((const __m128i*)shuffle.gather[o][i]);
+            gathered = _mm_or_si128(gathered, _mm_shuffle_epi8(in[i], control));
+        }
+        _mm_storeu_si128((__m128i*)(scratch + 16 * o), gathered);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that scatters the gathered bytes back into a block of 16 pixels with pshufb
+  and merges them into the selected lanes only.
+*/
+template<int C>
+CPU_TARGET("ssse3")
+static void scatterBlockShuffle(const ChannelShuffle& shuffle, const uint8_t* scratch, uint8_t* block) {
+    __m128i gathered[C];
+    for(int o = 0; o < shuffle.selected; ++o) {
+        gathered[o] = _mm_loadu_si128((const __m128i*)(scratch + 16 * o));
+    }
+    for(int i = 0; i < C; ++i) {
+        __m128i scattered = _mm_setzero_si128();
+        for(int o = 0; o < shuffle.selected; ++o) {
+            __m128i control = _mm_load_si128((const __m128i*)shuffle.scatter[i][o]);
+            scattered = _mm_or_si128(scattered, _mm_shuffle_epi8(gathered[o], control));
+        }
+        __m128i select = _mm_load_si128((const __m128i*)shuffle.select[i]);
+        __m128i* dst = (__m128i*)(block + 16 * i);
+        __m128i kept = _mm_andnot_si128(select, _mm_loadu_si128(dst));
+        _mm_storeu_si128(dst, _mm_or_si128(kept, _mm_and_si128(select, scattered)));
+    }
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that gathers the selected bytes of a block with pshufb when the dispatch allows it.
+*/
+template<int C>
+static inline void gatherBlock(const ChannelShuffle& shuffle, const uint8_t* block, uint8_t* scratch) {
+#ifdef CPU_FEATURES_X86
+    if(lsbKernels.shuffles) {
+        gatherBlockShuffle<C>(shuffle, block, scratch);
+        return;
+    }
+#endif
+    gatherBlockPortable<C>(shuffle, block, scratch);
+}
+
+//! A function variable.
+/*!
+  A function that scatters the gathered bytes back into a block with pshufb when the dispatch allows it.
+*/
+template<int C>
+static inline void scatterBlock(const ChannelShuffle& shuffle, const uint8_t* scratch, uint8_t* block) {
+#ifdef CPU_FEATURES_X86
+    if(lsbKernels.shuffles) {
+        scatterBlockShuffle<C>(shuffle, scratch, block);
+        return;
+    }
+#endif
+    scatterBlockPortable<C>(shuffle, scratch, block);
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload into the masked channels of pixels with C channels, 16 pixels per block.
+  Every block takes exactly 2 * selected * bitsPerChannel payload bytes; the last partial block is
+  processed in a zero-padded copy so it never touches pixels past the ones the payload needs.
+*/
+template<int C>
+static void embedMaskedBlocks(const ChannelShuffle& shuffle, int bitsPerChannel, uint8_t* pixels, const uint8_t* payload, size_t payloadSize) {
+    const size_t blockBytes = 16 * C;
+    const size_t blockPayload = 2 * shuffle.selected * bitsPerChannel;
+    uint8_t scratch[64];
+
+    size_t blocks = payloadSize / blockPayload;
+    for(size_t b = 0; b < blocks; ++b) {
+        uint8_t* block = pixels + b * blockBytes;
+        gatherBlock<C>(shuffle, block, scratch);
+        embedBitsPerChannel(bitsPerChannel, scratch, payload + b * blockPayload, blockPayload);
+        scatterBlock<C>(shuffle, scratch, block);
+    }
+
+    size_t rest = payloadSize - blocks * blockPayload;
+    if(rest != 0) {
+        size_t tailBytes = pixelsForPayload(shuffle.selected, bitsPerChannel, rest) * C;
+        uint8_t block[64] = {0};
+        memcpy(block, pixels + blocks * blockBytes, tailBytes);
+        gatherBlock<C>(shuffle, block, scratch);
+        embedBitsPerChannel(bitsPerChannel, scratch, payload + blocks * blockPayload, rest);
+        scatterBlock<C>(shuffle, scratch, block);
+        memcpy(pixels + blocks * blockBytes, block, tailBytes);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload from the masked channels of pixels with C channels, 16 pixels per block.
+*/
+template<int C>
+static void extractMaskedBlocks(const ChannelShuffle& shuffle, int bitsPerChannel, uint8_t* payload, const uint8_t* pixels, size_t payloadSize) {
+    const size_t blockBytes = 16 * C;
+    const size_t blockPayload = 2 * shuffle.selected * bitsPerChannel;
+    uint8_t scratch[64];
+
+    size_t blocks = payloadSize / blockPayload;
+    for(size_t b = 0; b < blocks; ++b) {
+        gatherBlock<C>(shuffle, pixels + b * blockBytes, scratch);
+        extractBitsPerChannel(bitsPerChannel, payload + b * blockPayload, scratch, blockPayload);
+    }
+
+    size_t rest = payloadSize - blocks * blockPayload;
+    if(rest != 0) {
+        size_t tailBytes = pixelsForPayload(shuffle.selected, bitsPerChannel, rest) * C;
+        uint8_t block[64] = {0};
+        memcpy(block, pixels + blocks * blockBytes, tailBytes);
+        gatherBlock<C>(shuffle, block, scratch);
+        extractBitsPerChannel(bitsPerChannel, payload + blocks * blockPayload, scratch, rest);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that checks whether the mask selects every channel, in which case the carrier is dense.
+  Return type: boolean.
+*/
+static bool selectsAllChannels(int channels, uint8_t channelMask) {
+    return channelMask == 0 || channelMask == (uint8_t)((1 << channels) - 1);
+}
+
+//! A function variable.
+/*!
+  A function that counts the channels selected by the mask.
+*/
+int selectedChannels(int channels, uint8_t channelMask) {
+    if(selectsAllChannels(channels, channelMask)) {
+        return channels;
+    }
+    int count = 0;
+    for(int channel = 0; channel < channels; ++channel) {
+        count += (channelMask >> channel) & 1;
+    }
+    return count;
+}
+
+//! A function variable.
+/*!
+  A function that returns how many pixels hold payloadSize bytes.
+*/
+size_t pixelsForPayload(int selected, int bitsPerChannel, size_t payloadSize) {
+    return (carrierBytesForPayload(bitsPerChannel, payloadSize) + selected - 1) / selected;
+}
+
+//! A function variable.
+/*!
+  A function that returns the smallest unit the masked kernels process independently:
+  one group of the K-bit kernel for dense carriers, one block of 16 pixels otherwise.
+*/
+void carrierUnit(int channels, uint8_t channelMask, int bitsPerChannel, size_t& payloadBytes, size_t& carrierBytes) {
+    if(selectsAllChannels(channels, channelMask)) {
+        payloadBytes = bitsPerChannel == 3 ? 3 : 1;
+        carrierBytes = payloadBytes * 8 / bitsPerChannel;
+        return;
+    }
+    payloadBytes = 2 * selectedChannels(channels, channelMask) * bitsPerChannel;
+    carrierBytes = 16 * channels;
+}
+
+//! A function variable.
+/*!
+  A function that embeds the payload into the masked channels with the kernel specialized for the channel count.
+*/
+void embedBitsMasked(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* pixels, const uint8_t* payload, size_t payloadSize) {
+    if(selectsAllChannels(channels, channelMask)) {
+        embedBitsPerChannel(bitsPerChannel, pixels, payload, payloadSize);
+        return;
+    }
+    ChannelShuffle shuffle;
+    buildChannelShuffle(shuffle, channels, channelMask);
+    switch(channels) {
+        case 2:
+            embedMaskedBlocks<2>(shuffle, bitsPerChannel, pixels, payload, payloadSize);
+            break;
+        case 3:
+            embedMaskedBlocks<3>(shuffle, bitsPerChannel, pixels, payload, payloadSize);
+            break;
+        case 4:
+            embedMaskedBlocks<4>(shuffle, bitsPerChannel, pixels, payload, payloadSize);
+            break;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that extracts the payload from the masked channels with the kernel specialized for the channel count.
+*/
+void extractBitsMasked(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* payload, const uint8_t* pixels, size_t payloadSize) {
+    if(selectsAllChannels(channels, channelMask)) {
+        extractBitsPerChannel(bitsPerChannel, payload, pixels, payloadSize);
+        return;
+    }
+    ChannelShuffle shuffle;
+    buildChannelShuffle(shuffle, channels, channelMask);
+    switch(channels) {
+        case 2:
+            extractMaskedBlocks<2>(shuffle, bitsPerChannel, payload, pixels, payloadSize);
+            break;
+        case 3:
+            extractMaskedBlocks<3>(shuffle, bitsPerChannel, payload, pixels, payloadSize);
+            break;
+        case 4:
+            extractMaskedBlocks<4>(shuffle, bitsPerChannel, payload, pixels, payloadSize);
+            break;
+    }
+}
@@ -0,0 +1,176 @@
+//!  LSB kernels.
+/*!
+  Functions that embed payload bytes into the least significant bits of carrier bytes and extract them back.
+  Every payload byte is spread over 8 carrier bytes, most significant bit first.
+*/
+
+#ifndef ImageSteganography_LSB_KERNELS_H
+#define ImageSteganography_LSB_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+//! A function variable.
+/*!
+  A function that embeds payloadSize bytes into the LSBs of 8 * payloadSize carrier bytes, one bit at a time.
+  It is the reference implementation every vectorized kernel has to match bit for bit.
+*/
+void embedBitsScalar(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that embeds the payload with 64-bit SWAR operations and a 256-entry spread table.
+  It is the portable fallback for little-endian CPUs without vector units, BMI2 or with a slow pdep;
+  on big-endian targets it runs the scalar kernel.
+*/
+void embedBitsSWAR(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that embeds the payload with SSE2, 4 payload bytes (32 carrier bytes) per iteration.
+*/
+void embedBitsSSE2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that embeds the payload with AVX2, 8 payload bytes (64 carrier bytes) per iteration.
+*/
+void embedBitsAVX2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that embeds the payload with BMI2 pdep, 8 payload bytes per 64-bit load, one pdep per 64-bit carrier word.
+*/
+void embedBitsBMI2(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that embeds the payload with AVX-512BW, 8 payload bytes (64 carrier bytes) per mask register.
+*/
+void embedBitsAVX512BW(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+#endif
+
+//! A function variable.
+/*!
+  A function that embeds the payload with the kernel bound by the runtime dispatch.
+*/
+void embedBits(uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that rebuilds payloadSize bytes from the LSBs of 8 * payloadSize carrier bytes, one bit at a time.
+  It is the reference implementation every vectorized kernel has to match bit for bit.
+*/
+void extractBitsScalar(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload with 64-bit SWAR operations, one multiplication per payload byte.
+*/
+void extractBitsSWAR(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that extracts the payload with SSE2 pmovmskb, 16 carrier LSBs per instruction.
+*/
+void extractBitsSSE2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload with AVX2 vpmovmskb, 32 carrier LSBs per instruction.
+*/
+void extractBitsAVX2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload with BMI2 pext, one pext per 64-bit carrier word, 8 payload bytes per 64-bit store.
+*/
+void extractBitsBMI2(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload with AVX-512BW vptestmb, 64 carrier LSBs per instruction.
+*/
+void extractBitsAVX512BW(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+#endif
+
+//! A function variable.
+/*!
+  A function that extracts the payload with the kernel bound by the runtime dispatch.
+*/
+void extractBits(uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes hold payloadSize bytes when every carrier byte holds bitsPerChannel bits.
+*/
+size_t carrierBytesForPayload(int bitsPerChannel, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that embeds the payload into the lowest bitsPerChannel (1-4) bits of every carrier byte, most significant bit first.
+  Every bit count has its own template-instantiated kernel; 1 bit per channel uses the dispatched embedBits.
+  A payload that does not fill the last carrier byte is padded with zero bits.
+*/
+void embedBitsPerChannel(int bitsPerChannel, uint8_t* carrier, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts payloadSize bytes from the lowest bitsPerChannel (1-4) bits of every carrier byte.
+  Every bit count has its own template-instantiated kernel; 1 bit per channel uses the dispatched extractBits.
+*/
+void extractBitsPerChannel(int bitsPerChannel, uint8_t* payload, const uint8_t* carrier, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that counts the channels selected by the mask (bit c selects channel c, 0 selects all of them).
+*/
+int selectedChannels(int channels, uint8_t channelMask);
+
+//! A function variable.
+/*!
+  A function that returns how many pixels hold payloadSize bytes when `selected` channels per pixel hold bitsPerChannel bits each.
+*/
+size_t pixelsForPayload(int selected, int bitsPerChannel, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that returns the smallest unit the masked kernels process independently of its neighbours:
+  payloadBytes payload bytes in carrierBytes carrier bytes. Any run of whole units can be embedded or extracted on its own.
+*/
+void carrierUnit(int channels, uint8_t channelMask, int bitsPerChannel, size_t& payloadBytes, size_t& carrierBytes);
+
+//! A function variable.
+/*!
+  A function that embeds the payload into the channels selected by channelMask of pixels with 1 to 4 channels.
+  The selected bytes are the carrier, in pixel order; an empty or full mask uses the dense kernels.
+  Other masks run a pshufb gather/scatter loop specialized at compile time for 2, 3 and 4 channels.
+*/
+void embedBitsMasked(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* pixels, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload from the channels selected by channelMask of pixels with 1 to 4 channels.
+*/
+void extractBitsMasked(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* payload, const uint8_t* pixels, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that returns the instruction set embedBits and extractBits are bound to.
+  At startup it is the fastest one the CPU supports, unless the STEGO_ISA environment variable names another one.
+*/
+InstructionSet activeInstructionSet();
+
+//! A function variable.
+/*!
+  A function that binds embedBits and extractBits to the kernels of the given instruction set.
+  It fails when the CPU does not support the instruction set.
+  Return type: boolean.
+*/
+bool forceInstructionSet(InstructionSet isa);
+
+#endif //ImageSteganography_LSB_KERNELS_H
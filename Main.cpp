@@ -3,14 +3,26 @@
     A class with enum storing modes - flags, print help, check if operation mode is specified, parse command line and main functions.
 */
 
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 #include <memory>
 
+#include "FileCommit.h"
 #include "ImageHelper.h"
+#include "LsbKernels.h"
+#include "PngProfile.h"
+#include "PngStream.h"
+#include "ThreadPool.h"
 
 std::string filepath; //!< A variable that stores the file path.
 std::string message; //!< A variable that stores the message.
+std::string payloadPath; //!< A variable that stores the path of the payload file given with --payload, "-" for standard input.
+std::string outputPath; //!< A variable that stores the file the decoded message is written to, given with --output.
+uint64_t payloadSizeHint = 0; //!< A variable that stores the payload size given with --size, 0 if not given.
+bool instructionSetForced = false; //!< A variable that tells whether --isa was given.
+InstructionSet instructionSet = InstructionSet::SCALAR; //!< A variable that stores the instruction set given with --isa.
+StegoSettings settings; //!< A variable that stores the settings the message is encoded with.
 
 //! An enum.
 /*! An enum that stores modes - flags. */
@@ -33,6 +45,16 @@ void printHelp() {
               -e, --encrypt  Specify file path and message. Check if file path extends supported format. If yes, the given message is write down on the image.
               -d, --decrypt  Specify file path from from which you want to read the message. Checks if file path extends supported format.
               -c, --check  Specify file path and message. Check if the given message could be wrote down on/read from the given file.
+              -p, --payload  Specify a file (or - for standard input) whose bytes are the message, instead of giving the message. Used with -e and -c, e.g. -e image.png -p archive.zip.
+              -o, --output  Specify a file the decoded message is written to, for messages longer than 255 bytes or binary ones. Used with -d.
+              -s, --size  Specify the payload size in bytes when it cannot be taken from the payload file (pipes, standard input).
+              -b, --bits  Specify how many low bits of every channel hold the message (1-4, default 1). Used with -e and -c; -d reads it from the image.
+              -m, --mask  Specify the channels that hold the message as channel indexes, e.g. 012 for RGB without alpha or 2 for blue only (default all). Used with -e and -c.
+              -t, --threads  Specify how many threads embed and extract large messages (default: number of CPU cores).
+              --sync  Specify what is flushed to disk when the image is written: none, file (default) or dir (the file and the directory entry of the rename). The image is always replaced atomically.
+              --profile  Specify how PNG images are written: fastest (one fixed filter, shallow match search), balanced (default) or smallest (every filter choice tried, deep match search). The time it took is printed.
+              --stream  Specify that PNG images are encoded a few row bands at a time, never decoded as a whole, so memory use does not grow with the image height. Images of 1 GB and more decoded are always streamed. With the smallest profile the filters are then picked per row.
+              --isa  Specify the instruction set of the embed/extract kernels (scalar, swar, sse2, ssse3, avx2, bmi2, avx512bw) instead of detecting it. Same as the STEGO_ISA environment variable.
               -h, --help  Displays help message (this one).)===" << std::endl;
 }
 
@@ -45,6 +67,15 @@ bool checkIfOperationModeSpecified(const MODE& m) {
     return m == MODE::NOT_SPECIFIED;
 }
 
+//! A function variable.
+/*!
+  A function that checks if the argument is the payload option, which takes the place of the message.
+  Return type: boolean.
+*/
+bool isPayloadOption(const std::string& arg) {
+    return arg == "-p" || arg == "--payload";
+}
+
 //! A function variable.
 /*!
   A function that takes the number of the arguments and the vector of the arguments value given by user in command line
@@ -89,8 +120,10 @@ int parseCommandLine(size_t numArgs, const std::vector<std::string>& argv) {
                 return -1;
             }
             if(hasMoreArgs(argIndex)) {
-                argIndex++;
-                message = argv[argIndex];
+                if(!isPayloadOption(argv[argIndex + 1])) {
+                    argIndex++;
+                    message = argv[argIndex];
+                }
             }
              else {
                 std::cerr << currArg << ", missing next argument (message)." << std::endl;
@@ -125,14 +158,152 @@ int parseCommandLine(size_t numArgs, const std::vector<std::string>& argv) {
                 return -1;
             }
             if(hasMoreArgs(argIndex)) {
-                argIndex++;
-                message = argv[argIndex];
+                if(!isPayloadOption(argv[argIndex + 1])) {
+                    argIndex++;
+                    message = argv[argIndex];
+                }
             }
             else {
                 std::cerr << currArg << ", missing next argument (message)." << std::endl;
                 return -1;
             }
         }
+        else if(currArg == "-b" || currArg == "--bits") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                const auto& value = argv[argIndex];
+                if(value.size() != 1 || value[0] < '1' || value[0] > '0' + STEG_MAX_BITS_PER_CHANNEL) {
+                    std::cerr << currArg << ", bits per channel must be between 1 and " << STEG_MAX_BITS_PER_CHANNEL << "." << std::endl;
+                    return -1;
+                }
+                settings.bitsPerChannel = value[0] - '0';
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (bits per channel)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "-m" || currArg == "--mask") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                const auto& value = argv[argIndex];
+                settings.channelMask = 0;
+                for(char channel : value) {
+                    if(channel < '0' || channel > '3') {
+                        std::cerr << currArg << ", channel indexes must be between 0 and 3." << std::endl;
+                        return -1;
+                    }
+                    settings.channelMask |= (uint8_t)(1 << (channel - '0'));
+                }
+                if(settings.channelMask == 0) {
+                    std::cerr << currArg << ", no channel specified." << std::endl;
+                    return -1;
+                }
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (channel indexes)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "-t" || currArg == "--threads") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                char* end = nullptr;
+                unsigned long threads = strtoul(argv[argIndex].c_str(), &end, 10);
+                if(*end != '\0' || threads == 0 || threads > 1024) {
+                    std::cerr << currArg << ", number of threads must be between 1 and 1024." << std::endl;
+                    return -1;
+                }
+                setStegoThreadCount((unsigned)threads);
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (number of threads)." << std::endl;
+                return -1;
+            }
+        }
+        else if(isPayloadOption(currArg)) {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                payloadPath = argv[argIndex];
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (payload file)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "-o" || currArg == "--output") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                outputPath = argv[argIndex];
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (output file)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "-s" || currArg == "--size") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                char* end = nullptr;
+                unsigned long long size = strtoull(argv[argIndex].c_str(), &end, 10);
+                if(*end != '\0' || size == 0) {
+                    std::cerr << currArg << ", payload size must be a positive number of bytes." << std::endl;
+                    return -1;
+                }
+                payloadSizeHint = size;
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (payload size)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "--sync") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                SyncPolicy policy = SyncPolicy::FILE;
+                if(!parseSyncPolicy(argv[argIndex], policy)) {
+                    std::cerr << currArg << ", unknown sync policy " << argv[argIndex] << " (none, file, dir)." << std::endl;
+                    return -1;
+                }
+                setSyncPolicy(policy);
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (sync policy)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "--stream") {
+            setPngStreaming(true);
+        }
+        else if(currArg == "--profile") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                PngProfile profile = PngProfile::BALANCED;
+                if(!parsePngProfile(argv[argIndex], profile)) {
+                    std::cerr << currArg << ", unknown PNG profile " << argv[argIndex] << " (fastest, balanced, smallest)." << std::endl;
+                    return -1;
+                }
+                setPngProfile(profile);
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (PNG profile)." << std::endl;
+                return -1;
+            }
+        }
+        else if(currArg == "--isa") {
+            if(hasMoreArgs(argIndex)) {
+                argIndex++;
+                if(!parseInstructionSet(argv[argIndex], instructionSet)) {
+                    std::cerr << currArg << ", unknown instruction set " << argv[argIndex] << "." << std::endl;
+                    return -1;
+                }
+                instructionSetForced = true;
+            }
+            else {
+                std::cerr << currArg << ", missing next argument (instruction set)." << std::endl;
+                return -1;
+            }
+        }
         else {
             std::cerr << "Unknown option specified" << std::endl;
             return -1;
@@ -152,15 +323,31 @@ int main(int argc, char** argv) {
         printHelp();
         return -1;
     }
-    ImageHelper imHelper(filepath, message);
+    if(instructionSetForced && !forceInstructionSet(instructionSet)) {
+        std::cerr << "The " << instructionSetName(instructionSet) << " instruction set is not supported by this CPU." << std::endl;
+        return -1;
+    }
+    ImageHelper imHelper(filepath, message, settings);
     switch(operatingMode) {
         case MODE::CHECK:
+            if(!payloadPath.empty()) {
+                imHelper.checkFile(payloadPath, payloadSizeHint);
+                break;
+            }
             imHelper.check();
             break;
         case MODE::DECRYPT:
+            if(!outputPath.empty()) {
+                imHelper.decodeFile(outputPath);
+                break;
+            }
             imHelper.decode();
             break;
         case MODE::ENCRYPT:
+            if(!payloadPath.empty()) {
+                imHelper.encodeFile(payloadPath, payloadSizeHint);
+                break;
+            }
             imHelper.encode();
             break;
         case MODE::INFO:
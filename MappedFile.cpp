@@ -0,0 +1,99 @@
+//!  A mapped file class.
+/*!
+    A class that maps a file with mmap, or reads it with pread where mapping is not possible.
+*/
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+//! A destructor.
+/*!
+  A destructor that unmaps the file; the buffer of the fallback path frees itself.
+*/
+MappedFile::~MappedFile() {
+    if(mapping != nullptr) {
+        munmap(mapping, length);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that maps the file, or reads it when mmap fails.
+  Return type: boolean.
+*/
+bool MappedFile::open(const char* filename) {
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    length = (size_t)info.st_size;
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    bool success = true;
+    if(view != MAP_FAILED) {
+        mapping = view;
+        madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+    else {
+        success = readAll(fd, length);
+    }
+    close(fd);
+    return success;
+}
+
+//! A function variable.
+/*!
+  A function that reads the file into the buffer with pread, retrying short and interrupted reads.
+  Return type: boolean.
+*/
+bool MappedFile::readAll(int fd, size_t fileSize) {
+    buffer.reset(new uint8_t[fileSize]);
+    size_t done = 0;
+    while(done < fileSize) {
+        size_t count = fileSize - done < MAPPED_FILE_READ_SIZE ? fileSize - done : MAPPED_FILE_READ_SIZE;
+        ssize_t got = pread(fd, buffer.get() + done, count, (off_t)done);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            buffer.reset();
+            return false;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that returns the contents of the file.
+*/
+const uint8_t* MappedFile::data() const {
+    return mapping != nullptr ? (const uint8_t*)mapping : buffer.get();
+}
+
+//! A function variable.
+/*!
+  A function that returns the size of the file.
+*/
+size_t MappedFile::size() const {
+    return length;
+}
+
+//! A function variable.
+/*!
+  A function that tells whether the contents are a mapping.
+  Return type: boolean.
+*/
+bool MappedFile::isMapped() const {
+    return mapping != nullptr;
+}
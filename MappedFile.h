@@ -0,0 +1,75 @@
+//!  A mapped file class.
+/*!
+  A class that makes the contents of a file available in memory, by mapping it when the filesystem allows that
+  and by reading it with pread otherwise, so image decoders can work on one contiguous buffer.
+*/
+
+#ifndef ImageSteganography_MAPPED_FILE_H
+#define ImageSteganography_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define MAPPED_FILE_READ_SIZE (8 << 20) //!< The number of bytes one pread of the fallback path asks for.
+
+//! A class.
+/*! A class that owns a read-only view of a whole file. */
+class MappedFile {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates an empty view.
+    */
+    MappedFile() {}
+
+    //! A destructor.
+    /*!
+      A destructor that unmaps or frees the contents.
+    */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that maps the file read-only and advises the kernel that it is read sequentially.
+      If the file cannot be mapped (pipes, some network and FUSE filesystems) it is read with pread instead.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that returns the contents of the file.
+    */
+    const uint8_t* data() const;
+
+    //! A function variable.
+    /*!
+      A function that returns the size of the file.
+    */
+    size_t size() const;
+
+    //! A function variable.
+    /*!
+      A function that tells whether the contents are a mapping rather than a copy.
+      Return type: boolean.
+    */
+    bool isMapped() const;
+
+private:
+    //! A function variable.
+    /*!
+      A function that reads the whole file with pread in MAPPED_FILE_READ_SIZE pieces.
+      Return type: boolean.
+    */
+    bool readAll(int fd, size_t fileSize);
+
+    void* mapping = nullptr; //!< A variable that stores the mapping, nullptr when the file was read.
+    std::unique_ptr<uint8_t[]> buffer; //!< A variable that stores the contents read by the fallback path.
+    size_t length = 0; //!< A variable that stores the size of the file.
+};
+
+#endif //ImageSteganography_MAPPED_FILE_H
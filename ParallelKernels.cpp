@@ -0,0 +1,115 @@
+//!  Parallel kernels.
+/*!
+    Functions that plan cache-line-aligned chunks of a payload and run the masked kernels on them in parallel.
+*/
+
+#include <algorithm>
+
+#include "ParallelKernels.h"
+#include "LsbKernels.h"
+#include "ThreadPool.h"
+
+#define CACHE_LINE_SIZE 64
+#define MIN_CHUNK_CARRIER_BYTES (1 << 20)
+
+//! A structure.
+/*! A structure that stores how a payload is split into chunks of whole kernel units. */
+struct ChunkPlan {
+    size_t unitPayload = 0; //!< Payload bytes per kernel unit.
+    size_t unitCarriers = 0; //!< Carrier bytes per kernel unit.
+    size_t totalUnits = 0; //!< Kernel units the payload needs, the last one may be partial.
+    size_t leadUnits = 0; //!< Units before the first boundary that falls on a cache line.
+    size_t chunkUnits = 0; //!< Units per chunk after the first one.
+    size_t chunks = 0; //!< Number of chunks.
+
+    //! A function variable.
+    /*!
+      A function that returns the first unit of chunk i; chunk 0 also takes the lead units.
+    */
+    size_t boundary(size_t i) const {
+        return i == 0 ? 0 : std::min(totalUnits, leadUnits + i * chunkUnits);
+    }
+};
+
+//! A function variable.
+/*!
+  A function that returns the greatest common divisor.
+*/
+static size_t greatestCommonDivisor(size_t a, size_t b) {
+    while(b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+//! A function variable.
+/*!
+  A function that splits the payload into about 4 chunks per thread.
+  Chunk sizes are multiples of the units that span a whole number of cache lines, and the first chunk is
+  stretched by the lead units so that the following boundaries land on cache lines of the carrier.
+*/
+static ChunkPlan planChunks(const uint8_t* pixels, int channels, uint8_t channelMask, int bitsPerChannel, size_t payloadSize) {
+    ChunkPlan plan;
+    carrierUnit(channels, channelMask, bitsPerChannel, plan.unitPayload, plan.unitCarriers);
+    plan.totalUnits = (payloadSize + plan.unitPayload - 1) / plan.unitPayload;
+
+    size_t lineUnits = CACHE_LINE_SIZE / greatestCommonDivisor(plan.unitCarriers, CACHE_LINE_SIZE);
+    uintptr_t address = (uintptr_t)pixels;
+    for(size_t j = 0; j < lineUnits; ++j) {
+        if((address + j * plan.unitCarriers) % CACHE_LINE_SIZE == 0) {
+            plan.leadUnits = j;
+            break;
+        }
+    }
+
+    size_t threads = stegoThreadCount();
+    size_t minUnits = (MIN_CHUNK_CARRIER_BYTES + plan.unitCarriers - 1) / plan.unitCarriers;
+    size_t wanted = std::max(minUnits, (plan.totalUnits + threads * 4 - 1) / (threads * 4));
+    plan.chunkUnits = (wanted + lineUnits - 1) / lineUnits * lineUnits;
+
+    if(threads <= 1 || plan.totalUnits <= plan.leadUnits + plan.chunkUnits) {
+        plan.chunks = 1;
+    }
+    else {
+        plan.chunks = (plan.totalUnits - plan.leadUnits + plan.chunkUnits - 1) / plan.chunkUnits;
+    }
+    return plan;
+}
+
+//! A function variable.
+/*!
+  A function that embeds every chunk of the plan with embedBitsMasked on the stego thread pool.
+*/
+void embedBitsParallel(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* pixels, const uint8_t* payload, size_t payloadSize) {
+    ChunkPlan plan = planChunks(pixels, channels, channelMask, bitsPerChannel, payloadSize);
+    if(plan.chunks <= 1) {
+        embedBitsMasked(channels, channelMask, bitsPerChannel, pixels, payload, payloadSize);
+        return;
+    }
+    stegoThreadPool().parallelFor(plan.chunks, [&](size_t i) {
+        size_t first = plan.boundary(i) * plan.unitPayload;
+        size_t last = std::min(payloadSize, plan.boundary(i + 1) * plan.unitPayload);
+        embedBitsMasked(channels, channelMask, bitsPerChannel, pixels + plan.boundary(i) * plan.unitCarriers,
+                        payload + first, last - first);
+    });
+}
+
+//! A function variable.
+/*!
+  A function that extracts every chunk of the plan with extractBitsMasked on the stego thread pool.
+*/
+void extractBitsParallel(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* payload, const uint8_t* pixels, size_t payloadSize) {
+    ChunkPlan plan = planChunks(pixels, channels, channelMask, bitsPerChannel, payloadSize);
+    if(plan.chunks <= 1) {
+        extractBitsMasked(channels, channelMask, bitsPerChannel, payload, pixels, payloadSize);
+        return;
+    }
+    stegoThreadPool().parallelFor(plan.chunks, [&](size_t i) {
+        size_t first = plan.boundary(i) * plan.unitPayload;
+        size_t last = std::min(payloadSize, plan.boundary(i + 1) * plan.unitPayload);
+        extractBitsMasked(channels, channelMask, bitsPerChannel, payload + first,
+                          pixels + plan.boundary(i) * plan.unitCarriers, last - first);
+    });
+}
@@ -0,0 +1,27 @@
+//!  Parallel kernels.
+/*!
+  Functions that split the payload of one image into chunks and embed or extract them on the stego thread pool.
+  Every chunk is a run of whole kernel units whose carrier range starts on a cache line, so threads never
+  write the same cache line and the result is identical to a single-threaded run.
+*/
+
+#ifndef ImageSteganography_PARALLEL_KERNELS_H
+#define ImageSteganography_PARALLEL_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! A function variable.
+/*!
+  A function that embeds the payload like embedBitsMasked, with chunks of at least 1 MB of carrier bytes
+  spread over stegoThreadCount() threads. Small payloads run on the calling thread.
+*/
+void embedBitsParallel(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* pixels, const uint8_t* payload, size_t payloadSize);
+
+//! A function variable.
+/*!
+  A function that extracts the payload like extractBitsMasked, with chunks spread over stegoThreadCount() threads.
+*/
+void extractBitsParallel(int channels, uint8_t channelMask, int bitsPerChannel, uint8_t* payload, const uint8_t* pixels, size_t payloadSize);
+
+#endif //ImageSteganography_PARALLEL_KERNELS_H
@@ -0,0 +1,147 @@
+//!  A payload stream class.
+/*!
+    Functions that size and read a payload given as a file descriptor, and the sink of an extracted payload.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PayloadStream.h"
+
+//! A function variable.
+/*!
+  A function that takes the payload size from fstat for regular files and from the hint otherwise.
+  Return type: boolean.
+*/
+bool payloadStreamSize(int fd, uint64_t sizeHint, uint64_t& size) {
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        return false;
+    }
+    if(S_ISREG(info.st_mode)) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if(offset < 0 || offset > info.st_size) {
+            offset = 0;
+        }
+        size = (uint64_t)(info.st_size - offset);
+        if(sizeHint != 0 && sizeHint < size) {
+            size = sizeHint;
+        }
+        return true;
+    }
+    if(sizeHint == 0) {
+        return false;
+    }
+    size = sizeHint;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that reads until the buffer is full.
+  Return type: boolean.
+*/
+bool readPayloadChunk(int fd, uint8_t* buffer, size_t size) {
+    size_t done = 0;
+    while(done < size) {
+        ssize_t got = read(fd, buffer + done, size - done);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            return false;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that writes until the whole buffer is out.
+  Return type: boolean.
+*/
+bool writePayloadChunk(int fd, const uint8_t* buffer, size_t size) {
+    size_t done = 0;
+    while(done < size) {
+        ssize_t put = ::write(fd, buffer + done, size - done);
+        if(put < 0 && errno == EINTR) {
+            continue;
+        }
+        if(put <= 0) {
+            return false;
+        }
+        done += (size_t)put;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that returns a sink writing to the descriptor.
+*/
+PayloadSink PayloadSink::toDescriptor(int fd) {
+    PayloadSink sink;
+    sink.fd = fd;
+    return sink;
+}
+
+//! A function variable.
+/*!
+  A function that returns a sink writing to the replacement.
+*/
+PayloadSink PayloadSink::toFile(FileReplacement& file) {
+    PayloadSink sink;
+    sink.file = &file;
+    return sink;
+}
+
+//! A function variable.
+/*!
+  A function that returns a sink storing into the buffer.
+*/
+PayloadSink PayloadSink::toBuffer(uint8_t* buffer, size_t capacity) {
+    PayloadSink sink;
+    sink.buffer = buffer;
+    sink.capacity = capacity;
+    return sink;
+}
+
+//! A function variable.
+/*!
+  A function that hands out the next size bytes of the caller buffer and counts them as written.
+*/
+uint8_t* PayloadSink::reserve(uint64_t size) {
+    if(buffer == nullptr || size > capacity - written) {
+        return nullptr;
+    }
+    uint8_t* next = buffer + written;
+    written += size;
+    return next;
+}
+
+//! A function variable.
+/*!
+  A function that appends the bytes to the descriptor or the replacement, or copies them into the buffer.
+  Return type: boolean.
+*/
+bool PayloadSink::write(const uint8_t* data, size_t size) {
+    if(buffer != nullptr) {
+        if(size > capacity - written) {
+            return false;
+        }
+        memcpy(buffer + written, data, size);
+    }
+    else if(file != nullptr) {
+        if(!file->write(data, size)) {
+            return false;
+        }
+    }
+    else if(!writePayloadChunk(fd, data, size)) {
+        return false;
+    }
+    written += size;
+    return true;
+}
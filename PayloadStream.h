@@ -0,0 +1,86 @@
+//!  A payload stream class.
+/*!
+  Functions that read a binary payload from a file descriptor in fixed-size chunks, and a sink the extracted
+  payload is written to, so a payload never has to be held in memory as a whole and may contain any byte, NUL included.
+*/
+
+#ifndef ImageSteganography_PAYLOAD_STREAM_H
+#define ImageSteganography_PAYLOAD_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FileCommit.h"
+
+#define PAYLOAD_CHUNK_SIZE (4 << 20) //!< The number of payload bytes read from the descriptor at once.
+
+//! A function variable.
+/*!
+  A function that finds out how many payload bytes the descriptor delivers.
+  For a regular file it is the size reported by fstat minus the current offset; for pipes, terminals and
+  sockets fstat knows nothing, so sizeHint has to be given (0 means no hint).
+  Return type: boolean.
+*/
+bool payloadStreamSize(int fd, uint64_t sizeHint, uint64_t& size);
+
+//! A function variable.
+/*!
+  A function that reads exactly size bytes from the descriptor, retrying short and interrupted reads.
+  It fails when the descriptor reaches its end or reports an error first.
+  Return type: boolean.
+*/
+bool readPayloadChunk(int fd, uint8_t* buffer, size_t size);
+
+//! A function variable.
+/*!
+  A function that writes exactly size bytes to the descriptor, retrying short and interrupted writes.
+  Return type: boolean.
+*/
+bool writePayloadChunk(int fd, const uint8_t* buffer, size_t size);
+
+//! A structure.
+/*!
+  A structure that receives the extracted payload in order, either written to a file descriptor or to the new contents
+  of a file that is replaced, or stored in a caller buffer (which may be a mapping of the output file).
+*/
+struct PayloadSink {
+    int fd = -1; //!< A variable that stores the descriptor the payload is written to, -1 for a buffer sink.
+    FileReplacement* file = nullptr; //!< A variable that stores the replacement the payload is written to, nullptr for other sinks.
+    uint8_t* buffer = nullptr; //!< A variable that stores the caller buffer, nullptr for a descriptor sink.
+    size_t capacity = 0; //!< A variable that stores the size of the caller buffer.
+    uint64_t written = 0; //!< A variable that stores how many payload bytes the sink received so far.
+
+    //! A function variable.
+    /*!
+      A function that returns a sink writing to the descriptor.
+    */
+    static PayloadSink toDescriptor(int fd);
+
+    //! A function variable.
+    /*!
+      A function that returns a sink writing to the new contents of a file, which the caller commits once the payload is complete.
+    */
+    static PayloadSink toFile(FileReplacement& file);
+
+    //! A function variable.
+    /*!
+      A function that returns a sink storing into the buffer of capacity bytes.
+    */
+    static PayloadSink toBuffer(uint8_t* buffer, size_t capacity);
+
+    //! A function variable.
+    /*!
+      A function that returns where the next size bytes can be extracted directly, or nullptr when they have to go through write.
+      It is nullptr for descriptor and file sinks and for buffer sinks without room for size more bytes.
+    */
+    uint8_t* reserve(uint64_t size);
+
+    //! A function variable.
+    /*!
+      A function that appends size bytes to the sink.
+      Return type: boolean.
+    */
+    bool write(const uint8_t* data, size_t size);
+};
+
+#endif //ImageSteganography_PAYLOAD_STREAM_H
@@ -0,0 +1,527 @@
+//!  PNG filter kernels.
+/*!
+    Functions that filter, score and unfilter PNG rows with scalar code and with SSE2, bound at runtime.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "LsbKernels.h"
+#include "PngFilters.h"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+//! A function variable.
+/*!
+  A function that returns the Paeth predictor: the neighbour (left, above, upper left) closest to left + above - upper left,
+  ties going to left, then above.
+*/
+static inline int paethPredictor(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+//! A function variable.
+/*!
+  A function that reverses the filter one byte at a time. The bytes left of the first pixel count as zeros.
+  Return type: boolean.
+*/
+bool unfilterRowScalar(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step) {
+    switch(type) {
+        case 0:
+            break;
+        case 1:
+            for(size_t i = step; i < rowBytes; ++i) {
+                row[i] = (uint8_t)(row[i] + row[i - step]);
+            }
+            break;
+        case 2:
+            for(size_t i = 0; i < rowBytes; ++i) {
+                row[i] = (uint8_t)(row[i] + above[i]);
+            }
+            break;
+        case 3:
+            for(size_t i = 0; i < rowBytes; ++i) {
+                int left = i >= step ? row[i - step] : 0;
+                row[i] = (uint8_t)(row[i] + ((left + above[i]) >> 1));
+            }
+            break;
+        case 4:
+            for(size_t i = 0; i < rowBytes; ++i) {
+                int left = i >= step ? row[i - step] : 0;
+                int upperLeft = i >= step ? above[i - step] : 0;
+                row[i] = (uint8_t)(row[i] + paethPredictor(left, above[i], upperLeft));
+            }
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that returns a byte filtered with the filter of type (0-4), from the byte x, its left neighbour a,
+  the byte above b and the upper left one c.
+*/
+static inline uint8_t filterByte(int type, int x, int a, int b, int c) {
+    switch(type) {
+        case 0:
+            return (uint8_t)x;
+        case 1:
+            return (uint8_t)(x - a);
+        case 2:
+            return (uint8_t)(x - b);
+        case 3:
+            return (uint8_t)(x - ((a + b) >> 1));
+        default:
+            return (uint8_t)(x - paethPredictor(a, b, c));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that filters the bytes from begin to end of a row one at a time.
+*/
+static void filterBytes(int type, const uint8_t* row, const uint8_t* above, size_t begin, size_t end, size_t step, uint8_t* out) {
+    for(size_t i = begin; i < end; ++i) {
+        int left = i >= step ? row[i - step] : 0;
+        int upperLeft = i >= step ? above[i - step] : 0;
+        out[i] = filterByte(type, row[i], left, above[i], upperLeft);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that adds the scores of the five filters of the bytes from begin to end of a row, one byte at a time.
+*/
+static void scoreBytes(const uint8_t* row, const uint8_t* above, size_t begin, size_t end, size_t step, uint64_t scores[5]) {
+    for(size_t i = begin; i < end; ++i) {
+        int left = i >= step ? row[i - step] : 0;
+        int upperLeft = i >= step ? above[i - step] : 0;
+        for(int type = 0; type < 5; ++type) {
+            scores[type] += (uint64_t)abs((int8_t)filterByte(type, row[i], left, above[i], upperLeft));
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that filters a row one byte at a time.
+*/
+void filterRowScalar(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out) {
+    if(type == 0) {
+        memcpy(out, row, rowBytes);
+        return;
+    }
+    filterBytes(type, row, above, 0, rowBytes, step, out);
+}
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row one byte at a time.
+*/
+void filterScoresScalar(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]) {
+    std::fill(scores, scores + 5, 0);
+    scoreBytes(row, above, 0, rowBytes, step, scores);
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that loads a pixel of BPP bytes into the low bytes of a vector. Pixels of 3 and 6 bytes are loaded with
+  the first bytes of the next pixel when available bytes allow it, in one 4 or 8-byte load; the extra lanes are never
+  stored. Assembling them byte by byte through memory would stall every load on the stores before it.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static inline __m128i loadPixel(const uint8_t* p, size_t available) {
+    if(BPP == 4 || (BPP == 3 && available >= 4)) {
+        uint32_t value;
+        memcpy(&value, p, 4);
+        return _mm_cvtsi32_si128((int)value);
+    }
+    if(BPP == 3) {
+        return _mm_cvtsi32_si128((int)(p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)));
+    }
+    uint64_t value;
+    if(BPP == 8 || available >= 8) {
+        memcpy(&value, p, 8);
+    }
+    else {
+        uint32_t low;
+        uint16_t high;
+        memcpy(&low, p, 4);
+        memcpy(&high, p + 4, 2);
+        value = low | ((uint64_t)high << 32);
+    }
+    return _mm_cvtsi64_si128((long long)value);
+}
+
+//! A function variable.
+/*!
+  A function that stores the low BPP bytes of a vector.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static inline void storePixel(uint8_t* p, __m128i v) {
+    if(BPP <= 4) {
+        uint32_t value = (uint32_t)_mm_cvtsi128_si32(v);
+        if(BPP == 4) {
+            memcpy(p, &value, 4);
+            return;
+        }
+        uint16_t low = (uint16_t)value;
+        memcpy(p, &low, 2);
+        p[2] = (uint8_t)(value >> 16);
+        return;
+    }
+    uint64_t value = (uint64_t)_mm_cvtsi128_si64(v);
+    if(BPP == 8) {
+        memcpy(p, &value, 8);
+        return;
+    }
+    uint32_t low = (uint32_t)value;
+    uint16_t high = (uint16_t)(value >> 32);
+    memcpy(p, &low, 4);
+    memcpy(p + 4, &high, 2);
+}
+
+//! A function variable.
+/*!
+  A function that reverses Sub: every pixel adds the reconstructed pixel on its left, all its bytes at once.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static void unfilterSub(uint8_t* row, size_t rowBytes) {
+    __m128i a = _mm_setzero_si128();
+    for(size_t i = 0; i + BPP <= rowBytes; i += BPP) {
+        a = _mm_add_epi8(a, loadPixel<BPP>(row + i, rowBytes - i));
+        storePixel<BPP>(row + i, a);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns floor((a + b) / 2) of every byte. pavgb rounds up, so the lost low bit, (a ^ b) & 1, is subtracted.
+*/
+CPU_TARGET("sse2")
+static inline __m128i average8(__m128i a, __m128i b) {
+    return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+//! A function variable.
+/*!
+  A function that reverses Average with the pixel bytes.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static void unfilterAverage(uint8_t* row, const uint8_t* above, size_t rowBytes) {
+    __m128i a = _mm_setzero_si128();
+    for(size_t i = 0; i + BPP <= rowBytes; i += BPP) {
+        __m128i b = loadPixel<BPP>(above + i, rowBytes - i);
+        a = _mm_add_epi8(loadPixel<BPP>(row + i, rowBytes - i), average8(a, b));
+        storePixel<BPP>(row + i, a);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the absolute values of 16-bit lanes.
+*/
+CPU_TARGET("sse2")
+static inline __m128i absolute16(__m128i v) {
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+//! A function variable.
+/*!
+  A function that picks the lanes of yes where mask is set and the lanes of no elsewhere.
+*/
+CPU_TARGET("sse2")
+static inline __m128i select16(__m128i mask, __m128i yes, __m128i no) {
+    return _mm_or_si128(_mm_and_si128(mask, yes), _mm_andnot_si128(mask, no));
+}
+
+//! A function variable.
+/*!
+  A function that returns the Paeth predictor of pixel bytes widened to 16-bit lanes. With p = a + b - c the distances
+  are pa = |b - c|, pb = |a - c| and pc = |(b - c) + (a - c)|; the predictor is the neighbour of the smallest one,
+  compared in the order of the specification, so ties resolve as in the reference.
+*/
+CPU_TARGET("sse2")
+static inline __m128i paethPredictor16(__m128i a, __m128i b, __m128i c) {
+    __m128i toB = _mm_sub_epi16(b, c);
+    __m128i toA = _mm_sub_epi16(a, c);
+    __m128i pa = absolute16(toB);
+    __m128i pb = absolute16(toA);
+    __m128i pc = absolute16(_mm_add_epi16(toB, toA));
+    __m128i smallest = _mm_min_epi16(_mm_min_epi16(pa, pb), pc);
+    return select16(_mm_cmpeq_epi16(smallest, pa), a, select16(_mm_cmpeq_epi16(smallest, pb), b, c));
+}
+
+//! A function variable.
+/*!
+  A function that reverses Paeth with the pixel bytes widened to 16-bit lanes.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static void unfilterPaeth(uint8_t* row, const uint8_t* above, size_t rowBytes) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for(size_t i = 0; i + BPP <= rowBytes; i += BPP) {
+        __m128i b = _mm_unpacklo_epi8(loadPixel<BPP>(above + i, rowBytes - i), zero);
+        __m128i predictor = paethPredictor16(a, b, c);
+        __m128i x = _mm_add_epi8(loadPixel<BPP>(row + i, rowBytes - i), _mm_packus_epi16(predictor, predictor));
+        storePixel<BPP>(row + i, x);
+        a = _mm_unpacklo_epi8(x, zero);
+        c = b;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that reverses Up 16 bytes at a time, whatever the pixel size.
+*/
+CPU_TARGET("sse2")
+static void unfilterUp(uint8_t* row, const uint8_t* above, size_t rowBytes) {
+    size_t i = 0;
+    for(; i + 16 <= rowBytes; i += 16) {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(row + i)), _mm_loadu_si128((const __m128i*)(above + i)));
+        _mm_storeu_si128((__m128i*)(row + i), sum);
+    }
+    for(; i < rowBytes; ++i) {
+        row[i] = (uint8_t)(row[i] + above[i]);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that reverses Sub, Average or Paeth for pixels of BPP bytes.
+*/
+template<int BPP>
+CPU_TARGET("sse2")
+static void unfilterPixels(int type, uint8_t* row, const uint8_t* above, size_t rowBytes) {
+    switch(type) {
+        case 1:
+            unfilterSub<BPP>(row, rowBytes);
+            break;
+        case 3:
+            unfilterAverage<BPP>(row, above, rowBytes);
+            break;
+        default:
+            unfilterPaeth<BPP>(row, above, rowBytes);
+            break;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that reverses the filter with SSE2 where the pixel size has a kernel, and with the reference otherwise.
+  Return type: boolean.
+*/
+CPU_TARGET("sse2")
+bool unfilterRowSSE2(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step) {
+    if(type == 0) {
+        return true;
+    }
+    if(type == 2) {
+        unfilterUp(row, above, rowBytes);
+        return true;
+    }
+    if(type != 1 && type != 3 && type != 4) {
+        return false;
+    }
+    switch(step) {
+        case 3:
+            unfilterPixels<3>(type, row, above, rowBytes);
+            return true;
+        case 4:
+            unfilterPixels<4>(type, row, above, rowBytes);
+            return true;
+        case 6:
+            unfilterPixels<6>(type, row, above, rowBytes);
+            return true;
+        case 8:
+            unfilterPixels<8>(type, row, above, rowBytes);
+            return true;
+        default:
+            return unfilterRowScalar(type, row, above, rowBytes, step);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the Paeth predictor of 16 bytes.
+*/
+CPU_TARGET("sse2")
+static inline __m128i paethPredictor8(__m128i a, __m128i b, __m128i c) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i low = paethPredictor16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+    __m128i high = paethPredictor16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+    return _mm_packus_epi16(low, high);
+}
+
+//! A function variable.
+/*!
+  A function that returns 16 bytes x filtered with the filter of TYPE, from their left neighbours a, the bytes above b
+  and the upper left ones c.
+*/
+template<int TYPE>
+CPU_TARGET("sse2")
+static inline __m128i filterVector(__m128i x, __m128i a, __m128i b, __m128i c) {
+    switch(TYPE) {
+        case 0:
+            return x;
+        case 1:
+            return _mm_sub_epi8(x, a);
+        case 2:
+            return _mm_sub_epi8(x, b);
+        case 3:
+            return _mm_sub_epi8(x, average8(a, b));
+        default:
+            return _mm_sub_epi8(x, paethPredictor8(a, b, c));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the absolute values of 16 filtered bytes taken as signed numbers, summed by psadbw into
+  the two 64-bit lanes. As unsigned bytes, |v| is the smaller of v and -v, -128 included.
+*/
+CPU_TARGET("sse2")
+static inline __m128i scoreVector(__m128i v) {
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_sad_epu8(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), zero);
+}
+
+//! A function variable.
+/*!
+  A function that filters a row with the filter of TYPE 16 bytes at a time. The first pixel, which has no left
+  neighbour, and the last bytes are filtered by the reference.
+*/
+template<int TYPE>
+CPU_TARGET("sse2")
+static void filterVectors(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out) {
+    size_t i = std::min(step, rowBytes);
+    filterBytes(TYPE, row, above, 0, i, step, out);
+    for(; i + 16 <= rowBytes; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - step));
+        __m128i b = _mm_loadu_si128((const __m128i*)(above + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(above + i - step));
+        _mm_storeu_si128((__m128i*)(out + i), filterVector<TYPE>(x, a, b, c));
+    }
+    filterBytes(TYPE, row, above, i, rowBytes, step, out);
+}
+
+//! A function variable.
+/*!
+  A function that filters a row with SSE2.
+*/
+CPU_TARGET("sse2")
+void filterRowSSE2(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out) {
+    switch(type) {
+        case 0:
+            memcpy(out, row, rowBytes);
+            break;
+        case 1:
+            filterVectors<1>(row, above, rowBytes, step, out);
+            break;
+        case 2:
+            filterVectors<2>(row, above, rowBytes, step, out);
+            break;
+        case 3:
+            filterVectors<3>(row, above, rowBytes, step, out);
+            break;
+        default:
+            filterVectors<4>(row, above, rowBytes, step, out);
+            break;
+    }
+}
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row with SSE2: every 16 bytes are loaded once with their neighbours,
+  filtered five ways in registers and summed with psadbw into one accumulator per filter.
+*/
+CPU_TARGET("sse2")
+void filterScoresSSE2(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]) {
+    std::fill(scores, scores + 5, 0);
+    size_t i = std::min(step, rowBytes);
+    scoreBytes(row, above, 0, i, step, scores);
+    __m128i none = _mm_setzero_si128();
+    __m128i sub = none;
+    __m128i up = none;
+    __m128i average = none;
+    __m128i paeth = none;
+    for(; i + 16 <= rowBytes; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - step));
+        __m128i b = _mm_loadu_si128((const __m128i*)(above + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(above + i - step));
+        none = _mm_add_epi64(none, scoreVector(x));
+        sub = _mm_add_epi64(sub, scoreVector(filterVector<1>(x, a, b, c)));
+        up = _mm_add_epi64(up, scoreVector(filterVector<2>(x, a, b, c)));
+        average = _mm_add_epi64(average, scoreVector(filterVector<3>(x, a, b, c)));
+        paeth = _mm_add_epi64(paeth, scoreVector(filterVector<4>(x, a, b, c)));
+    }
+    __m128i sums[5] = {none, sub, up, average, paeth};
+    for(int type = 0; type < 5; ++type) {
+        scores[type] += (uint64_t)_mm_cvtsi128_si64(sums[type]) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums[type], sums[type]));
+    }
+    scoreBytes(row, above, i, rowBytes, step, scores);
+}
+#endif
+
+//! A function variable.
+/*!
+  A function that reverses the filter with the kernel the instruction set of the LSB kernels selects.
+  Return type: boolean.
+*/
+bool unfilterRow(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step) {
+#ifdef CPU_FEATURES_X86
+    InstructionSet isa = activeInstructionSet();
+    if(isa != InstructionSet::SCALAR && isa != InstructionSet::SWAR) {
+        return unfilterRowSSE2(type, row, above, rowBytes, step);
+    }
+#endif
+    return unfilterRowScalar(type, row, above, rowBytes, step);
+}
+
+//! A function variable.
+/*!
+  A function that filters a row with the kernel the instruction set of the LSB kernels selects.
+*/
+void filterRow(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out) {
+#ifdef CPU_FEATURES_X86
+    InstructionSet isa = activeInstructionSet();
+    if(isa != InstructionSet::SCALAR && isa != InstructionSet::SWAR) {
+        filterRowSSE2(type, row, above, rowBytes, step, out);
+        return;
+    }
+#endif
+    filterRowScalar(type, row, above, rowBytes, step, out);
+}
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row with the kernel the instruction set of the LSB kernels selects.
+*/
+void filterScores(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]) {
+#ifdef CPU_FEATURES_X86
+    InstructionSet isa = activeInstructionSet();
+    if(isa != InstructionSet::SCALAR && isa != InstructionSet::SWAR) {
+        filterScoresSSE2(row, above, rowBytes, step, scores);
+        return;
+    }
+#endif
+    filterScoresScalar(row, above, rowBytes, step, scores);
+}
@@ -0,0 +1,90 @@
+//!  PNG filter kernels.
+/*!
+  Functions that apply and reverse the PNG scanline filters (None, Sub, Up, Average, Paeth) of 8-bit rows.
+  The scalar functions are the reference; the SSE2 ones reconstruct a whole pixel of 3, 4, 6 or 8 bytes per step,
+  Paeth with 16-bit lanes as libpng does, and Up 16 bytes per step. Pixels of 3 and 6 bytes are read with one
+  wider load where the row allows it.
+  Filtering has no dependency between the bytes of a row, so the SSE2 filter kernels take 16 bytes per step
+  whatever the pixel size, and the score of the heuristic is summed with psadbw. Rows with other pixel sizes (grey,
+  grey and alpha, palettes and depths below 8 bits) use the reference for Sub, Average and Paeth.
+*/
+
+#ifndef ImageSteganography_PNG_FILTERS_H
+#define ImageSteganography_PNG_FILTERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+//! A function variable.
+/*!
+  A function that reverses the filter of type (0-4) of a row of rowBytes bytes in place, against the unfiltered
+  row above (all zeros for the first row); step is the distance of the left neighbour in bytes. It is the reference
+  every vectorized kernel has to match byte for byte.
+  Return type: boolean, false for an unknown filter type.
+*/
+bool unfilterRowScalar(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step);
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that reverses the filter of a row with SSE2.
+  Return type: boolean, false for an unknown filter type.
+*/
+bool unfilterRowSSE2(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step);
+#endif
+
+//! A function variable.
+/*!
+  A function that reverses the filter of a row with SSE2, unless the instruction set of the LSB kernels
+  was set to scalar or SWAR (see forceInstructionSet), which selects the reference.
+  Return type: boolean, false for an unknown filter type.
+*/
+bool unfilterRow(int type, uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step);
+
+//! A function variable.
+/*!
+  A function that filters a row of rowBytes bytes with the filter of type (0-4) into out, against the row above
+  (all zeros for the first row); the bytes left of the first pixel count as zeros. It is the reference
+  of the vectorized filter kernels.
+*/
+void filterRowScalar(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out);
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row in one pass, without writing the filtered bytes. The score of
+  a filter is the sum of the absolute values of its filtered bytes taken as signed numbers, the usual estimate
+  of how well the row compresses with it. It is the reference of the vectorized score kernel.
+*/
+void filterScoresScalar(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]);
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that filters a row with SSE2.
+*/
+void filterRowSSE2(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out);
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row with SSE2.
+*/
+void filterScoresSSE2(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]);
+#endif
+
+//! A function variable.
+/*!
+  A function that filters a row with SSE2, or with the reference when the instruction set of the LSB kernels
+  was set to scalar or SWAR.
+*/
+void filterRow(int type, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out);
+
+//! A function variable.
+/*!
+  A function that scores the five filters of a row with SSE2, or with the reference when the instruction set of
+  the LSB kernels was set to scalar or SWAR.
+*/
+void filterScores(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint64_t scores[5]);
+
+#endif //ImageSteganography_PNG_FILTERS_H
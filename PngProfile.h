@@ -0,0 +1,94 @@
+//!  A PNG profile module.
+/*!
+  Named PNG write profiles that trade encoding time for file size. A profile chooses how the scanline filters are picked
+  and how deep the deflate compressor searches for matches; the active profile is used by every PNG that Image::write renders
+  with the parallel PNG writer.
+*/
+
+#ifndef ImageSteganography_PNG_PROFILE_H
+#define ImageSteganography_PNG_PROFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! An enum.
+/*! An enum that stores the PNG write profiles. */
+enum class PngProfile {
+    FASTEST, /*!< Enum value FASTEST, one fixed filter and the shallowest match search. */
+    BALANCED, /*!< Enum value BALANCED, a filter picked per row and a moderate match search (default). */
+    SMALLEST /*!< Enum value SMALLEST, every filter choice is tried and the smallest file is kept, with a deep match search. */
+};
+
+//! An enum.
+/*! An enum that stores how the scanline filters are picked. */
+enum class FilterStrategy {
+    FIXED, /*!< Enum value FIXED, every row uses the same filter. */
+    HEURISTIC, /*!< Enum value HEURISTIC, every row uses the filter with the smallest sum of absolute filtered values. */
+    EXHAUSTIVE /*!< Enum value EXHAUSTIVE, the image is compressed with every fixed filter and with the heuristic, and the smallest result is kept. */
+};
+
+//! A structure.
+/*! A structure that stores the settings of a PNG write profile. */
+struct PngWriteSettings {
+    FilterStrategy filter = FilterStrategy::HEURISTIC; //!< A variable that stores how the filters are picked.
+    int fixedFilter = 0; //!< A variable that stores the filter of FIXED (0 none, 1 sub, 2 up, 3 average, 4 Paeth).
+    int matchDepth = 8; //!< A variable that stores how many hash chain entries every match search compares.
+};
+
+//! A function variable.
+/*!
+  A function that returns the name of the profile, as given on the command line.
+*/
+const char* pngProfileName(PngProfile profile);
+
+//! A function variable.
+/*!
+  A function that takes the name of a profile (fastest, balanced, smallest) and stores the matching value.
+  Return type: boolean.
+*/
+bool parsePngProfile(const std::string& name, PngProfile& profile);
+
+//! A function variable.
+/*!
+  A function that returns the settings of the profile.
+*/
+PngWriteSettings pngWriteSettings(PngProfile profile);
+
+//! A function variable.
+/*!
+  A function that returns the profile PNG files are written with.
+*/
+PngProfile pngProfile();
+
+//! A function variable.
+/*!
+  A function that sets the profile PNG files are written with.
+*/
+void setPngProfile(PngProfile profile);
+
+//! A function variable.
+/*!
+  A function that returns the filter the band encoder uses for the settings: the fixed filter, or
+  PNG_HEURISTIC_FILTER (a filter picked per row) for the heuristic and for the exhaustive search, which tries the
+  fixed filters besides it only when the whole image is encoded at once.
+*/
+int pngBandFilter(const PngWriteSettings& settings);
+
+//! A function variable.
+/*!
+  A function that prints the line every PNG write reports: the active profile, how the filters were picked and
+  the filter the file got, the match depth, the file size and the time it took. A non-null note, such as how the file
+  was written, is appended.
+*/
+void printPngWrite(int filter, uint64_t bytes, double elapsed, const char* note);
+
+//! A function variable.
+/*!
+  A function that renders the pixels as a PNG file into out with the active profile and prints the profile,
+  the resulting size and the time it took.
+  Return type: boolean.
+*/
+bool renderPng(const uint8_t* data, int w, int h, int channels, std::vector<uint8_t>& out);
+
+#endif //ImageSteganography_PNG_PROFILE_H
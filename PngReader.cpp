@@ -0,0 +1,307 @@
+//!  A PNG reader class.
+/*!
+    A class that parses PNG chunks and decodes scanlines one at a time with the incremental inflater.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "PngFilters.h"
+#include "PngReader.h"
+
+#define PNG_CHUNK(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+static const uint8_t pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10}; //!< The first bytes of every PNG file.
+static const uint8_t depthScale[9] = {0, 0xFF, 0x55, 0, 0x11, 0, 0, 0, 0x01}; //!< The factor that stretches grey samples of a depth to 8 bits, as in stb_image.
+
+//! A function variable.
+/*!
+  A function that copies the next bytes of the file.
+  Return type: boolean.
+*/
+bool PngReader::readBytes(uint8_t* out, size_t size) {
+    if(size > file.size() - offset) {
+        return false;
+    }
+    memcpy(out, file.data() + offset, size);
+    offset += size;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that skips the next bytes of the file.
+  Return type: boolean.
+*/
+bool PngReader::skipBytes(size_t size) {
+    if(size > file.size() - offset) {
+        return false;
+    }
+    offset += size;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that reads a big-endian 32-bit number from the file.
+  Return type: boolean.
+*/
+bool PngReader::readBigEndian32(uint32_t& value) {
+    uint8_t bytes[4];
+    if(!readBytes(bytes, 4)) {
+        return false;
+    }
+    value = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that opens the file and reads IHDR, PLTE and tRNS up to the first IDAT chunk,
+  with the same checks stb_image makes.
+  Return type: boolean.
+*/
+bool PngReader::open(const char* filename) {
+    if(!file.open(filename)) {
+        return false;
+    }
+    uint8_t signature[8];
+    if(!readBytes(signature, 8) || memcmp(signature, pngSignature, 8) != 0) {
+        return false;
+    }
+    bool first = true;
+    int paletteSize = 0;
+    bool paletteAlpha = false;
+    uint8_t header[13];
+    uint32_t length = 0;
+    uint32_t type = 0;
+    while(readBigEndian32(length) && readBigEndian32(type)) {
+        if(first && type != PNG_CHUNK('I', 'H', 'D', 'R')) {
+            return false;
+        }
+        if(type == PNG_CHUNK('I', 'H', 'D', 'R')) {
+            if(!first || length != 13 || !readBytes(header, 13)) {
+                return false;
+            }
+            first = false;
+            width = (int)(((uint32_t)header[0] << 24) | ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) | header[3]);
+            height = (int)(((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7]);
+            bitDepth = header[8];
+            colorType = header[9];
+            if(width <= 0 || height <= 0 || (1 << 30) / width / 4 < height) {
+                return false;
+            }
+            if(bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16) {
+                return false;
+            }
+            if(colorType > 6 || (colorType == 3 && bitDepth == 16) || (colorType != 3 && (colorType & 1) != 0)) {
+                return false;
+            }
+            if((colorType == 2 || colorType == 4 || colorType == 6) && bitDepth < 8) {
+                return false;
+            }
+            if(header[10] != 0 || header[11] != 0 || header[12] != 0) {
+                return false;
+            }
+            samples = colorType == 3 ? 1 : (colorType & 2 ? 3 : 1) + (colorType & 4 ? 1 : 0);
+        }
+        else if(type == PNG_CHUNK('P', 'L', 'T', 'E')) {
+            if(length > 256 * 3 || length % 3 != 0) {
+                return false;
+            }
+            paletteSize = (int)length / 3;
+            for(int i = 0; i < paletteSize; ++i) {
+                if(!readBytes(palette + i * 4, 3)) {
+                    return false;
+                }
+                palette[i * 4 + 3] = 255;
+            }
+        }
+        else if(type == PNG_CHUNK('t', 'R', 'N', 'S')) {
+            if(colorType == 3) {
+                if(paletteSize == 0 || (int)length > paletteSize) {
+                    return false;
+                }
+                for(uint32_t i = 0; i < length; ++i) {
+                    if(!readBytes(palette + i * 4 + 3, 1)) {
+                        return false;
+                    }
+                }
+                paletteAlpha = true;
+            }
+            else {
+                if((samples & 1) == 0 || length != (uint32_t)samples * 2) {
+                    return false;
+                }
+                uint8_t values[6];
+                if(!readBytes(values, length)) {
+                    return false;
+                }
+                for(int k = 0; k < samples; ++k) {
+                    uint16_t value = (uint16_t)((values[2 * k] << 8) | values[2 * k + 1]);
+                    transparentColor[k] = bitDepth == 16 ? value : (uint8_t)((value & 255) * depthScale[bitDepth]);
+                }
+                hasTransparentColor = true;
+            }
+        }
+        else if(type == PNG_CHUNK('I', 'D', 'A', 'T')) {
+            if(colorType == 3 && paletteSize == 0) {
+                return false;
+            }
+            chunkRemaining = length;
+            break;
+        }
+        else if(type == PNG_CHUNK('I', 'E', 'N', 'D') || (type & (1u << 29)) == 0) {
+            return false;
+        }
+        else if(!skipBytes(length)) {
+            return false;
+        }
+        if(type != PNG_CHUNK('I', 'D', 'A', 'T') && !skipBytes(4)) {
+            return false;
+        }
+    }
+    if(first || type != PNG_CHUNK('I', 'D', 'A', 'T')) {
+        return false;
+    }
+
+    if(colorType == 3) {
+        channels = paletteAlpha ? 4 : 3;
+    }
+    else {
+        channels = samples + (hasTransparentColor ? 1 : 0);
+    }
+    int bitsPerPixel = samples * bitDepth;
+    rowBytes = ((size_t)width * bitsPerPixel + 7) / 8;
+    filterStep = bitsPerPixel < 8 ? 1 : bitsPerPixel / 8;
+    previous.assign(rowBytes, 0);
+    current.assign(rowBytes + 1, 0);
+    inflater.reset(new Inflater([this](uint8_t* buffer, size_t size) { return readImageData(buffer, size); }));
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that copies IDAT data, skipping the CRC and header between consecutive IDAT chunks.
+  The data ends at the first chunk of another type.
+*/
+size_t PngReader::readImageData(uint8_t* buffer, size_t size) {
+    size_t done = 0;
+    while(done < size && !imageDataEnded) {
+        if(chunkRemaining == 0) {
+            uint32_t length = 0;
+            uint32_t type = 0;
+            if(!skipBytes(4) || !readBigEndian32(length) || !readBigEndian32(type)
+               || type != PNG_CHUNK('I', 'D', 'A', 'T')) {
+                imageDataEnded = true;
+                break;
+            }
+            chunkRemaining = length;
+            continue;
+        }
+        size_t count = std::min<size_t>(size - done, chunkRemaining);
+        size_t got = std::min(count, file.size() - offset);
+        memcpy(buffer + done, file.data() + offset, got);
+        offset += got;
+        done += got;
+        chunkRemaining -= (uint32_t)got;
+        if(got != count) {
+            imageDataEnded = true;
+        }
+    }
+    return done;
+}
+
+//! A function variable.
+/*!
+  A function that reverses the filter of the current row with the dispatched kernel of PngFilters.
+  The previous row of the first row is all zeros, which turns the filters into their first-row forms.
+  Return type: boolean.
+*/
+bool PngReader::unfilterRow() {
+    uint8_t* row = current.data() + 1;
+    if(!::unfilterRow(current[0], row, previous.data(), rowBytes, (size_t)filterStep)) {
+        return false;
+    }
+    memcpy(previous.data(), row, rowBytes);
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that converts the unfiltered row: samples below 8 bits are unpacked (grey ones stretched to 8 bits),
+  16-bit samples keep their high byte, palette indexes are looked up and a tRNS colour adds an alpha channel.
+*/
+void PngReader::convertRow(uint8_t* out) const {
+    const uint8_t* row = previous.data();
+    if(colorType == 3 && bitDepth == 8) {
+        for(int x = 0; x < width; ++x) {
+            const uint8_t* color = palette + row[x] * 4;
+            out[0] = color[0];
+            out[1] = color[1];
+            out[2] = color[2];
+            if(channels == 4) {
+                out[3] = color[3];
+            }
+            out += channels;
+        }
+        return;
+    }
+    if(colorType == 3 || bitDepth < 8) {
+        uint8_t scale = colorType == 3 ? 1 : depthScale[bitDepth];
+        int perByte = 8 / bitDepth;
+        int mask = (1 << bitDepth) - 1;
+        for(int x = 0; x < width; ++x) {
+            int shift = bitDepth == 8 ? 0 : 8 - bitDepth * (x % perByte + 1);
+            uint8_t value = (uint8_t)((row[x / perByte] >> shift) & mask);
+            if(colorType == 3) {
+                memcpy(out, palette + value * 4, channels);
+                out += channels;
+                continue;
+            }
+            value = (uint8_t)(value * scale);
+            *out++ = value;
+            if(hasTransparentColor) {
+                *out++ = value == transparentColor[0] ? 0 : 255;
+            }
+        }
+        return;
+    }
+    if(bitDepth == 8 && !hasTransparentColor) {
+        memcpy(out, row, rowBytes);
+        return;
+    }
+    int bytes = bitDepth / 8;
+    for(int x = 0; x < width; ++x) {
+        bool transparent = hasTransparentColor;
+        for(int k = 0; k < samples; ++k) {
+            const uint8_t* sample = row + ((size_t)x * samples + k) * bytes;
+            uint16_t value = bytes == 2 ? (uint16_t)((sample[0] << 8) | sample[1]) : sample[0];
+            transparent = transparent && value == transparentColor[k];
+            *out++ = sample[0];
+        }
+        if(hasTransparentColor) {
+            *out++ = transparent ? 0 : 255;
+        }
+    }
+}
+
+//! A function variable.
+/*!
+  A function that inflates, unfilters and converts the next rows.
+  Return type: boolean.
+*/
+bool PngReader::readRows(uint8_t* out, int rows) {
+    if(inflater == nullptr || rows > height - rowsRead) {
+        return false;
+    }
+    size_t outRow = (size_t)width * channels;
+    for(int r = 0; r < rows; ++r) {
+        if(inflater->read(current.data(), rowBytes + 1) != rowBytes + 1 || !unfilterRow()) {
+            return false;
+        }
+        convertRow(out + r * outRow);
+        rowsRead++;
+    }
+    return true;
+}
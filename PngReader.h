@@ -0,0 +1,112 @@
+//!  A PNG reader class.
+/*!
+  A class that decodes a PNG file one scanline at a time, so a caller that needs only the first rows
+  (the stego header and a short payload) stops inflating and unfiltering as soon as it has them.
+  The file is read through a MappedFile, like the other carriers, so only the pages the rows come from are touched.
+  Rows come out in the layout stbi_load(filename, ..., 0) returns: 8 bits per channel, palettes expanded,
+  a tRNS colour turned into an alpha channel.
+*/
+
+#ifndef ImageSteganography_PNG_READER_H
+#define ImageSteganography_PNG_READER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Inflate.h"
+#include "MappedFile.h"
+
+//! A class.
+/*! A class that reads the header chunks of a PNG file and then its rows in order. */
+class PngReader {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates a reader with no file.
+    */
+    PngReader() {}
+
+    PngReader(const PngReader&) = delete;
+    PngReader& operator=(const PngReader&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that opens the file and reads the chunks before the first IDAT chunk.
+      It fails for files that are not PNG, are corrupt, are interlaced or use the iPhone (CgBI) variant;
+      the callers then fall back to stbi_load.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that decodes the next rows into out, width * channels bytes per row.
+      Return type: boolean.
+    */
+    bool readRows(uint8_t* out, int rows);
+
+    int width = 0; //!< A variable that stores the image width.
+    int height = 0; //!< A variable that stores the image height.
+    int channels = 0; //!< A variable that stores the number of channels of the decoded rows, as stbi_load reports them.
+    int rowsRead = 0; //!< A variable that stores how many rows were decoded so far.
+
+private:
+    //! A function variable.
+    /*!
+      A function that copies the next size bytes of the file into out.
+      Return type: boolean, false when the file ends first.
+    */
+    bool readBytes(uint8_t* out, size_t size);
+
+    //! A function variable.
+    /*!
+      A function that skips the next size bytes of the file.
+      Return type: boolean, false when the file ends first.
+    */
+    bool skipBytes(size_t size);
+
+    //! A function variable.
+    /*!
+      A function that reads a big-endian 32-bit number from the file.
+      Return type: boolean.
+    */
+    bool readBigEndian32(uint32_t& value);
+
+    //! A function variable.
+    /*!
+      A function that copies up to size bytes of IDAT data into the buffer, moving on to the following IDAT chunks.
+    */
+    size_t readImageData(uint8_t* buffer, size_t size);
+
+    //! A function variable.
+    /*!
+      A function that reverses the filter of the current row against the previous one.
+      Return type: boolean.
+    */
+    bool unfilterRow();
+
+    //! A function variable.
+    /*!
+      A function that converts the unfiltered row to 8-bit output channels.
+    */
+    void convertRow(uint8_t* out) const;
+
+    MappedFile file; //!< A variable that stores the contents of the file.
+    size_t offset = 0; //!< A variable that stores the offset of the next byte to read.
+    uint32_t chunkRemaining = 0; //!< A variable that stores the unread bytes of the current IDAT chunk.
+    bool imageDataEnded = false; //!< A variable that tells whether a chunk other than IDAT followed the IDAT chunks.
+    int bitDepth = 0; //!< A variable that stores the bits per sample.
+    int colorType = 0; //!< A variable that stores the PNG colour type.
+    int samples = 0; //!< A variable that stores the samples per pixel in the file (1 for palette images).
+    size_t rowBytes = 0; //!< A variable that stores the bytes of a filtered row without its filter byte.
+    int filterStep = 0; //!< A variable that stores the distance of the left neighbour used by the filters, in bytes.
+    bool hasTransparentColor = false; //!< A variable that tells whether a tRNS chunk gave a transparent colour.
+    uint16_t transparentColor[3] = {0}; //!< A variable that stores the transparent colour, scaled like the output for depths up to 8.
+    uint8_t palette[256 * 4] = {0}; //!< A variable that stores the palette as RGBA.
+    std::vector<uint8_t> previous; //!< A variable that stores the previous unfiltered row.
+    std::vector<uint8_t> current; //!< A variable that stores the current row, filter byte first.
+    std::unique_ptr<Inflater> inflater; //!< A variable that stores the inflater of the IDAT stream.
+};
+
+#endif //ImageSteganography_PNG_READER_H
@@ -0,0 +1,189 @@
+//!  A PNG splice class.
+/*!
+    A class that finds the bands of a PNG file, decodes the leading ones and splices new bands in front of the kept ones.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "Deflate.h"
+#include "FileCommit.h"
+#include "PngProfile.h"
+#include "PngReader.h"
+#include "PngSplice.h"
+
+static const uint8_t pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10}; //!< The first bytes of every PNG file.
+
+//! A function variable.
+/*!
+  A function that reads a big-endian 32-bit number.
+*/
+static uint32_t getBigEndian32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+//! A function variable.
+/*!
+  A function that walks the chunks up to IEND. The stBD chunk may come before or after the image data,
+  and the IDAT chunks have to be consecutive.
+  Return type: boolean.
+*/
+bool PngSplice::open(const char* filename) {
+    if(!file.open(filename)) {
+        return false;
+    }
+    this->filename = filename;
+    const uint8_t* data = file.data();
+    size_t size = file.size();
+    if(size < 8 || memcmp(data, pngSignature, 8) != 0) {
+        return false;
+    }
+    bool hasIndex = false;
+    bool dataEnded = false;
+    size_t pos = 8;
+    while(pos + 12 <= size) {
+        uint32_t length = getBigEndian32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if(length > size - pos - 12) {
+            return false;
+        }
+        size_t next = pos + 12 + length;
+        if(pos == 8) {
+            if(memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                return false;
+            }
+            width = (int)getBigEndian32(body);
+            height = (int)getBigEndian32(body + 4);
+            const int channelsOfType[7] = {1, 0, 3, 0, 2, 0, 4};
+            if(width <= 0 || height <= 0 || (1 << 30) / width / 4 < height || body[8] != 8 || body[9] > 6
+               || channelsOfType[body[9]] == 0 || body[10] != 0 || body[11] != 0 || body[12] != 0) {
+                return false;
+            }
+            channels = channelsOfType[body[9]];
+        }
+        else if(memcmp(type, "stBD", 4) == 0) {
+            if(hasIndex || !index.parse(body, length, height)) {
+                return false;
+            }
+            hasIndex = true;
+            indexBegin = pos;
+            indexEnd = next;
+        }
+        else if(memcmp(type, "IDAT", 4) == 0) {
+            if(dataEnded) {
+                return false;
+            }
+            bandOffsets.push_back(pos);
+            dataEnd = next;
+        }
+        else if(memcmp(type, "tRNS", 4) == 0) {
+            return false;
+        }
+        else if(memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        else {
+            dataEnded = !bandOffsets.empty();
+        }
+        pos = next;
+    }
+    if(!hasIndex || bandOffsets.size() != index.checksums.size() + 1) {
+        return false;
+    }
+    size_t trailer = bandOffsets.back();
+    return getBigEndian32(data + trailer) == 4 && getBigEndian32(data + trailer + 8) == index.streamChecksum(width, height, channels);
+}
+
+//! A function variable.
+/*!
+  A function that compares the filter of the strategy with the one of the file.
+  Return type: boolean.
+*/
+bool PngSplice::keepsFilters(const PngWriteSettings& settings) const {
+    return settings.filter != FilterStrategy::EXHAUSTIVE && pngBandFilter(settings) == index.filter;
+}
+
+//! A function variable.
+/*!
+  A function that picks the first band to keep and decodes the rows before it.
+  The filtered rows change up to the row after the last changed one, whose Up, Average and Paeth filters read it.
+*/
+std::unique_ptr<Image> PngSplice::loadPrefix(uint64_t carrierBytes) {
+    size_t rowSize = (size_t)width * channels;
+    size_t lineBytes = rowSize + 1;
+    uint64_t neededRows = (carrierBytes + rowSize - 1) / rowSize;
+    if(neededRows == 0) {
+        neededRows = 1;
+    }
+    uint64_t changedBytes = std::min<uint64_t>((uint64_t)height, neededRows + 1) * lineBytes;
+    uint64_t bandBytes = (uint64_t)index.rowsPerBand * lineBytes;
+    uint64_t keptBand = (changedBytes + DEFLATE_WINDOW_SIZE + bandBytes - 1) / bandBytes;
+    int rows = (int)std::min<uint64_t>((uint64_t)height, keptBand * index.rowsPerBand);
+
+    PngReader reader;
+    if(!reader.open(filename.c_str()) || reader.width != width || reader.height != height || reader.channels != channels) {
+        return nullptr;
+    }
+    std::unique_ptr<Image> prefix(new Image(width, rows, channels));
+    if(!reader.readRows(prefix->data, rows)) {
+        return nullptr;
+    }
+    return prefix;
+}
+
+//! A function variable.
+/*!
+  A function that writes the chunks before the image data, the new bands, the kept IDAT chunks as they are,
+  the new Adler-32 and the chunks after the image data, with the stBD chunk updated wherever it is.
+  The kept chunks are written straight from the mapping of the old file, so nothing close to the file size is held in memory.
+  Return type: boolean.
+*/
+bool PngSplice::commit(const Image& prefix, size_t& reused, uint64_t& fileSize) {
+    std::vector<PngBand> bands;
+    PngBandEncoder encoder(width, channels, index.filter, pngWriteSettings(pngProfile()).matchDepth, index.rowsPerBand);
+    encoder.encode(prefix.data, prefix.h, prefix.h == height, bands);
+    PngBandIndex updated = index;
+    for(size_t band = 0; band < bands.size(); ++band) {
+        updated.checksums[band] = bands[band].checksum;
+    }
+    uint32_t adler = updated.streamChecksum(width, height, channels);
+
+    FileReplacement out;
+    if(!out.open(filename.c_str())) {
+        return false;
+    }
+    const uint8_t* data = file.data();
+    std::vector<uint8_t> chunk;
+    auto copyRange = [&](size_t begin, size_t end) {
+        if(indexBegin < begin || indexEnd > end) {
+            return out.write(data + begin, end - begin);
+        }
+        chunk.clear();
+        updated.put(chunk);
+        return out.write(data + begin, indexBegin - begin) && out.write(chunk.data(), chunk.size())
+               && out.write(data + indexEnd, end - indexEnd);
+    };
+    size_t keptBegin = bandOffsets[bands.size()];
+    size_t keptEnd = bandOffsets.back();
+    reused = keptEnd - keptBegin;
+    if(!copyRange(0, bandOffsets[0])) {
+        return false;
+    }
+    for(const PngBand& band : bands) {
+        chunk.clear();
+        putPngChunk(chunk, "IDAT", band.data.data(), band.data.size(), band.crc);
+        if(!out.write(chunk.data(), chunk.size())) {
+            return false;
+        }
+    }
+    uint8_t trailer[4] = {(uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler};
+    chunk.clear();
+    putPngChunk(chunk, "IDAT", trailer, sizeof(trailer), pngChunkCrc("IDAT", trailer, sizeof(trailer)));
+    if(!out.write(data + keptBegin, keptEnd - keptBegin) || !out.write(chunk.data(), chunk.size())
+       || !copyRange(dataEnd, file.size())) {
+        return false;
+    }
+    fileSize = out.size();
+    return out.commit();
+}
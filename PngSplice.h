@@ -0,0 +1,86 @@
+//!  A PNG splice class.
+/*!
+  A class that re-encodes a PNG file written by this program after its first rows changed. The stBD chunk tells which
+  IDAT chunk holds which rows, so only the bands up to the last changed row are decoded, filtered and deflated again;
+  the compressed bands after them are copied into the new file byte for byte. A short payload in a large image then
+  costs time in proportion to the payload, not to the image.
+*/
+
+#ifndef ImageSteganography_PNG_SPLICE_H
+#define ImageSteganography_PNG_SPLICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+#include "MappedFile.h"
+#include "PngProfile.h"
+#include "PngWriter.h"
+
+//! A class.
+/*! A class that replaces the leading bands of a PNG file written by encodePng. */
+class PngSplice {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates a splice with no file.
+    */
+    PngSplice() {}
+
+    PngSplice(const PngSplice&) = delete;
+    PngSplice& operator=(const PngSplice&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that maps the file and finds its IHDR, stBD and IDAT chunks. It fails for files without a valid
+      stBD chunk, for files whose IDAT chunks are not one per band followed by the Adler-32, and for files
+      stbi_load would not return as they are stored (other depths, interlacing, tRNS); those files are rewritten instead.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that tells whether new bands encoded with the settings get the filters a rewrite of the whole file
+      would get: the strategy has to use the filter stored in the stBD chunk and must not be the exhaustive search,
+      which compares encodings of the whole image.
+      Return type: boolean.
+    */
+    bool keepsFilters(const PngWriteSettings& settings) const;
+
+    //! A function variable.
+    /*!
+      A function that returns an image with the first rows of the file, decoded with PngReader: the rows that hold
+      carrierBytes bytes and the rest of the bands they reach, extended until the 32 KB window of the first band
+      that is kept lies in rows that do not change. It returns nullptr when decoding fails.
+    */
+    std::unique_ptr<Image> loadPrefix(uint64_t carrierBytes);
+
+    //! A function variable.
+    /*!
+      A function that filters and deflates the rows of the prefix into bands with the filter choice of the file and
+      the match depth of the active PNG write profile, and replaces the file with the new bands followed by
+      the kept ones. The number of compressed bytes copied from the old file is returned in reused
+      and the size of the new file in fileSize.
+      Return type: boolean.
+    */
+    bool commit(const Image& prefix, size_t& reused, uint64_t& fileSize);
+
+    int width = 0; //!< A variable that stores the image width.
+    int height = 0; //!< A variable that stores the image height.
+    int channels = 0; //!< A variable that stores the number of channels, as stbi_load reports them.
+    PngBandIndex index; //!< A variable that stores the contents of the stBD chunk.
+
+private:
+    std::string filename; //!< A variable that stores the name of the file.
+    MappedFile file; //!< A variable that stores the contents of the file.
+    size_t indexBegin = 0; //!< A variable that stores the offset of the stBD chunk.
+    size_t indexEnd = 0; //!< A variable that stores the offset after the stBD chunk.
+    size_t dataEnd = 0; //!< A variable that stores the offset after the IDAT chunk with the Adler-32.
+    std::vector<size_t> bandOffsets; //!< A variable that stores the offset of the IDAT chunk of every band and of the Adler-32 one.
+};
+
+#endif //ImageSteganography_PNG_SPLICE_H
@@ -0,0 +1,174 @@
+//!  A PNG stream class.
+/*!
+    A class that moves rows from the PNG reader through the embedding kernels into the band encoder and the new file.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "FileCommit.h"
+#include "LsbKernels.h"
+#include "ParallelKernels.h"
+#include "PngProfile.h"
+#include "PngStream.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+
+static bool alwaysStream = false; //!< Whether PNG files are always streamed, set with setPngStreaming.
+
+//! A function variable.
+/*!
+  A function that tells whether PNG files are always streamed.
+  Return type: boolean.
+*/
+bool pngStreaming() {
+    return alwaysStream;
+}
+
+//! A function variable.
+/*!
+  A function that sets whether PNG files are always streamed.
+*/
+void setPngStreaming(bool always) {
+    alwaysStream = always;
+}
+
+//! A function variable.
+/*!
+  A function that opens the reader and takes the image size from it.
+  Return type: boolean.
+*/
+bool PngStreamEncoder::open(const char* filename) {
+    if(!reader.open(filename)) {
+        return false;
+    }
+    this->filename = filename;
+    width = reader.width;
+    height = reader.height;
+    channels = reader.channels;
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that runs the pipeline. The row buffer holds one band per thread and the rows a kernel unit can span,
+  but no more bands than fit in PNG_BAND_SIZE bytes per thread: when a single row is larger than a band, fewer bands
+  are buffered, down to one, so the buffer stays within a few rows however wide the image is.
+  Every round fills it with decoded rows, embeds the kernel units that end inside it (the stego header in the first round),
+  encodes the whole bands before the first unit still to come and moves the remaining rows to the front.
+  Because a unit is at most a few rows long, every full buffer yields all the bands it holds.
+  Return type: boolean.
+*/
+bool PngStreamEncoder::encode(const StegoSettings& settings, uint64_t payloadSize, const std::function<bool(uint8_t*, size_t)>& readPayload) {
+    StegoSettings effective = settings;
+    if(!effective.normalize(channels)) {
+        return false;
+    }
+    size_t rowSize = (size_t)width * channels;
+    uint64_t imageSize = (uint64_t)height * rowSize;
+    size_t unitPayload = 0;
+    size_t unitCarriers = 0;
+    carrierUnit(channels, effective.channelMask, effective.bitsPerChannel, unitPayload, unitCarriers);
+    uint64_t payloadOffset = stegoPayloadOffset(effective, channels, payloadSize);
+    uint64_t units = (payloadSize + unitPayload - 1) / unitPayload;
+
+    PngWriteSettings profile = pngWriteSettings(pngProfile());
+    filter = pngBandFilter(profile);
+    size_t rowsPerBand = pngRowsPerBand(width, channels);
+    size_t carryRows = (unitCarriers + rowSize - 1) / rowSize + 1;
+    size_t threads = std::max<size_t>(1, stegoThreadCount());
+    size_t bandsPerRound = std::max<size_t>(1, std::min(threads, threads * PNG_BAND_SIZE / (rowsPerBand * rowSize)));
+    size_t capacity = std::min<size_t>((size_t)height, bandsPerRound * rowsPerBand + carryRows);
+    std::vector<uint8_t> rows(capacity * rowSize);
+    bufferSize = rows.size();
+
+    FileReplacement out;
+    if(!out.open(filename.c_str())) {
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    putPngHeader(bytes, width, height, channels);
+    if(!out.write(bytes.data(), bytes.size())) {
+        return false;
+    }
+
+    PngBandEncoder encoder(width, channels, filter, profile.matchDepth, rowsPerBand);
+    PngBandIndex index;
+    index.rowsPerBand = (uint32_t)rowsPerBand;
+    index.filter = filter;
+    std::vector<PngBand> bands;
+    std::vector<uint8_t> chunk;
+    bool headerWritten = false;
+    size_t firstRow = 0;
+    size_t buffered = 0;
+    uint64_t nextUnit = 0;
+    while(firstRow < (size_t)height) {
+        size_t count = std::min(capacity - buffered, (size_t)height - firstRow - buffered);
+        if(!reader.readRows(rows.data() + buffered * rowSize, (int)count)) {
+            return false;
+        }
+        buffered += count;
+        uint64_t begin = (uint64_t)firstRow * rowSize;
+        uint64_t end = begin + (uint64_t)buffered * rowSize;
+        if(!headerWritten) {
+            writeStegoHeader(rows.data(), buffered * rowSize, effective, channels, payloadSize);
+            headerWritten = true;
+        }
+
+        uint64_t lastUnit = units;
+        if(end < imageSize) {
+            lastUnit = end > payloadOffset ? std::min(units, (end - payloadOffset) / unitCarriers) : 0;
+        }
+        if(lastUnit > nextUnit) {
+            uint64_t from = nextUnit * unitPayload;
+            size_t size = (size_t)(std::min(payloadSize, lastUnit * unitPayload) - from);
+            chunk.resize(size);
+            if(!readPayload(chunk.data(), size)) {
+                std::cerr << "The payload ended after " << from << " of " << payloadSize << " bytes" << std::endl;
+                return false;
+            }
+            embedBitsParallel(channels, effective.channelMask, effective.bitsPerChannel,
+                              rows.data() + (payloadOffset + nextUnit * unitCarriers - begin), chunk.data(), size);
+            nextUnit = lastUnit;
+        }
+
+        size_t finalRows = buffered;
+        if(nextUnit < units) {
+            finalRows = (size_t)((payloadOffset + nextUnit * unitCarriers) / rowSize) - firstRow;
+        }
+        bool last = firstRow + finalRows == (size_t)height;
+        size_t ready = last ? finalRows : finalRows / rowsPerBand * rowsPerBand;
+        if(ready == 0) {
+            if(count == 0) {
+                return false;
+            }
+            continue;
+        }
+        encoder.encode(rows.data(), (int)ready, last, bands);
+        for(const PngBand& band : bands) {
+            index.checksums.push_back(band.checksum);
+            bytes.clear();
+            putPngChunk(bytes, "IDAT", band.data.data(), band.data.size(), band.crc);
+            if(!out.write(bytes.data(), bytes.size())) {
+                return false;
+            }
+        }
+        memmove(rows.data(), rows.data() + ready * rowSize, (buffered - ready) * rowSize);
+        firstRow += ready;
+        buffered -= ready;
+    }
+
+    bytes.clear();
+    uint32_t adler = index.streamChecksum(width, height, channels);
+    uint8_t trailer[4] = {(uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler};
+    putPngChunk(bytes, "IDAT", trailer, sizeof(trailer), pngChunkCrc("IDAT", trailer, sizeof(trailer)));
+    index.put(bytes);
+    putPngChunk(bytes, "IEND", nullptr, 0, pngChunkCrc("IEND", nullptr, 0));
+    if(!out.write(bytes.data(), bytes.size())) {
+        return false;
+    }
+    fileSize = out.size();
+    return out.commit();
+}
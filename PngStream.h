@@ -0,0 +1,77 @@
+//!  A PNG stream class.
+/*!
+  A class that encodes a payload into a PNG file without ever holding the whole image: rows are decoded with PngReader,
+  the payload bits due in them are embedded, and they are filtered, deflated and written to the new file a few bands
+  at a time. Memory use depends on the row width and the number of threads, not on the image height, so carriers far
+  larger than the memory of the machine can be encoded. The file is the one Image::write would render, except that
+  its stBD chunk follows the image data and that the smallest profile picks the filters per row.
+*/
+
+#ifndef ImageSteganography_PNG_STREAM_H
+#define ImageSteganography_PNG_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "PngReader.h"
+#include "StegoHeader.h"
+
+#define PNG_STREAM_AUTO_SIZE ((uint64_t)1 << 30) //!< The decoded image size from which PNG files are always streamed.
+
+//! A class.
+/*! A class that decodes, embeds into and re-encodes a PNG file row band by row band. */
+class PngStreamEncoder {
+public:
+    //! A constructor.
+    /*!
+      A constructor that creates an encoder with no file.
+    */
+    PngStreamEncoder() {}
+
+    PngStreamEncoder(const PngStreamEncoder&) = delete;
+    PngStreamEncoder& operator=(const PngStreamEncoder&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that opens the file with PngReader. It fails for the files PngReader cannot stream.
+      Return type: boolean.
+    */
+    bool open(const char* filename);
+
+    //! A function variable.
+    /*!
+      A function that embeds the header and payloadSize bytes of payload with the settings, normalized for the image,
+      and replaces the file with the result. readPayload is called in order for the next bytes of the payload.
+      The capacity has to be checked before. On failure the file is left as it was.
+      Return type: boolean.
+    */
+    bool encode(const StegoSettings& settings, uint64_t payloadSize, const std::function<bool(uint8_t*, size_t)>& readPayload);
+
+    int width = 0; //!< A variable that stores the image width.
+    int height = 0; //!< A variable that stores the image height.
+    int channels = 0; //!< A variable that stores the number of channels, as stbi_load reports them.
+    size_t bufferSize = 0; //!< A variable that stores the size of the row buffer encode used.
+    int filter = 0; //!< A variable that stores the filter encode used, PNG_HEURISTIC_FILTER for a filter picked per row.
+    uint64_t fileSize = 0; //!< A variable that stores the size of the file encode wrote.
+
+private:
+    std::string filename; //!< A variable that stores the name of the file.
+    PngReader reader; //!< A variable that stores the reader of the rows.
+};
+
+//! A function variable.
+/*!
+  A function that tells whether PNG files are always streamed, not only those of PNG_STREAM_AUTO_SIZE bytes and more.
+  Return type: boolean.
+*/
+bool pngStreaming();
+
+//! A function variable.
+/*!
+  A function that sets whether PNG files are always streamed.
+*/
+void setPngStreaming(bool always);
+
+#endif //ImageSteganography_PNG_STREAM_H
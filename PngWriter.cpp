@@ -0,0 +1,282 @@
+//!  A PNG writer module.
+/*!
+    Functions that filter scanlines, deflate bands of them in parallel and write the PNG chunks.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "Deflate.h"
+#include "PngFilters.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+
+static const uint8_t pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10}; //!< The first bytes of every PNG file.
+static const uint8_t colorTypes[5] = {0, 0, 4, 2, 6}; //!< The PNG colour type of every number of channels.
+
+//! A function variable.
+/*!
+  A function that returns the CRC-32 table of the PNG chunks, built once.
+*/
+static const uint32_t* crcTable() {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for(uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for(int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[n] = c;
+            }
+        }
+    } table;
+    return table.entries;
+}
+
+//! A function variable.
+/*!
+  A function that updates a CRC-32 with size bytes; the CRC of a chunk starts at 0 and covers its type and data.
+*/
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t* table = crcTable();
+    crc = ~crc;
+    for(size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+//! A function variable.
+/*!
+  A function that appends a big-endian 32-bit number.
+*/
+static void putBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+//! A function variable.
+/*!
+  A function that reads a big-endian 32-bit number.
+*/
+static uint32_t getBigEndian32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+//! A function variable.
+/*!
+  A function that appends a chunk: its length, type, data and the CRC, which may have been computed before.
+*/
+void putPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size, uint32_t crc) {
+    putBigEndian32(out, (uint32_t)size);
+    out.insert(out.end(), type, type + 4);
+    if(size > 0) {
+        out.insert(out.end(), data, data + size);
+    }
+    putBigEndian32(out, crc);
+}
+
+//! A function variable.
+/*!
+  A function that returns the CRC of a chunk from its type and data.
+*/
+uint32_t pngChunkCrc(const char* type, const uint8_t* data, size_t size) {
+    return crc32(crc32(0, (const uint8_t*)type, 4), data, size);
+}
+
+//! A function variable.
+/*!
+  A function that parses the stBD chunk: the version, the rows per band, the filter choice (255 for the heuristic)
+  and one Adler-32 per band, all big-endian.
+  Return type: boolean.
+*/
+bool PngBandIndex::parse(const uint8_t* data, size_t size, int h) {
+    if(size < 6 || data[0] != PNG_BAND_INDEX_VERSION || (size - 6) % 4 != 0) {
+        return false;
+    }
+    rowsPerBand = getBigEndian32(data + 1);
+    filter = data[5] == 255 ? PNG_HEURISTIC_FILTER : data[5];
+    if(rowsPerBand == 0 || filter > 4 || h <= 0) {
+        return false;
+    }
+    size_t bands = ((size_t)h + rowsPerBand - 1) / rowsPerBand;
+    if((size - 6) / 4 != bands) {
+        return false;
+    }
+    checksums.resize(bands);
+    for(size_t band = 0; band < bands; ++band) {
+        checksums[band] = getBigEndian32(data + 6 + band * 4);
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that appends the stBD chunk.
+*/
+void PngBandIndex::put(std::vector<uint8_t>& out) const {
+    std::vector<uint8_t> data;
+    data.reserve(6 + checksums.size() * 4);
+    data.push_back(PNG_BAND_INDEX_VERSION);
+    putBigEndian32(data, rowsPerBand);
+    data.push_back(filter == PNG_HEURISTIC_FILTER ? 255 : (uint8_t)filter);
+    for(uint32_t checksum : checksums) {
+        putBigEndian32(data, checksum);
+    }
+    putPngChunk(out, "stBD", data.data(), data.size(), pngChunkCrc("stBD", data.data(), data.size()));
+}
+
+//! A function variable.
+/*!
+  A function that combines the checksums of the bands; every band but the last holds rowsPerBand filtered rows.
+*/
+uint32_t PngBandIndex::streamChecksum(int w, int h, int channels) const {
+    size_t lineBytes = (size_t)w * channels + 1;
+    uint32_t adler = checksums.empty() ? 1 : checksums[0];
+    for(size_t band = 1; band < checksums.size(); ++band) {
+        size_t rows = std::min<size_t>(rowsPerBand, (size_t)h - band * rowsPerBand);
+        adler = adler32Combine(adler, checksums[band], (uint64_t)rows * lineBytes);
+    }
+    return adler;
+}
+
+//! A function variable.
+/*!
+  A function that writes the filter type byte and the filtered row. The heuristic scores every type in one pass
+  over the row and filters it with the one of the lowest score; ties keep the lower type.
+*/
+static void encodeRow(int filter, const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t step, uint8_t* out) {
+    int type = filter;
+    if(filter == PNG_HEURISTIC_FILTER) {
+        uint64_t scores[5];
+        filterScores(row, above, rowBytes, step, scores);
+        type = (int)(std::min_element(scores, scores + 5) - scores);
+    }
+    out[0] = (uint8_t)type;
+    filterRow(type, row, above, rowBytes, step, out + 1);
+}
+
+//! A function variable.
+/*!
+  A function that returns how many rows go into one band, at least one.
+*/
+size_t pngRowsPerBand(int w, int channels) {
+    return std::max<size_t>(1, PNG_BAND_SIZE / ((size_t)w * channels + 1));
+}
+
+//! A constructor.
+/*!
+  A constructor that stores the geometry and settings of the bands.
+*/
+PngBandEncoder::PngBandEncoder(int w, int channels, int filter, int matchDepth, size_t rowsPerBand)
+    : rowBytes((size_t)w * channels), step((size_t)channels), filter(filter), matchDepth(matchDepth),
+      rowsPerBand(rowsPerBand), previousRow((size_t)w * channels, 0) {
+}
+
+//! A function variable.
+/*!
+  A function that filters the rows band by band, then deflates and checksums the bands, both on the thread pool.
+  The filtered rows follow the kept window in one buffer, so every band is primed with the 32 KB before it.
+*/
+void PngBandEncoder::encode(const uint8_t* pixels, int rows, bool last, std::vector<PngBand>& bands) {
+    size_t lineBytes = rowBytes + 1;
+    size_t count = ((size_t)rows + rowsPerBand - 1) / rowsPerBand;
+    size_t primed = window.size();
+    std::vector<uint8_t> buffer(primed + lineBytes * rows);
+    std::copy(window.begin(), window.end(), buffer.begin());
+    uint8_t* filtered = buffer.data() + primed;
+
+    ThreadPool& pool = stegoThreadPool();
+    pool.parallelFor(count, [&](size_t band) {
+        size_t end = std::min<size_t>((size_t)rows, (band + 1) * rowsPerBand);
+        for(size_t y = band * rowsPerBand; y < end; ++y) {
+            const uint8_t* above = y == 0 ? previousRow.data() : pixels + (y - 1) * rowBytes;
+            encodeRow(filter, pixels + y * rowBytes, above, rowBytes, step, filtered + y * lineBytes);
+        }
+    });
+
+    bands.assign(count, PngBand());
+    pool.parallelFor(count, [&](size_t band) {
+        size_t begin = band * rowsPerBand * lineBytes;
+        size_t size = std::min(lineBytes * rows, begin + rowsPerBand * lineBytes) - begin;
+        std::vector<uint8_t>& data = bands[band].data;
+        if(bandsDone + band == 0) {
+            data.push_back(0x78);
+            data.push_back(0x5E);
+        }
+        threadDeflater(matchDepth).compress(filtered + begin, std::min<size_t>(primed + begin, DEFLATE_WINDOW_SIZE), size, last && band + 1 == count, data);
+        bands[band].checksum = adler32(1, filtered + begin, size);
+        bands[band].crc = pngChunkCrc("IDAT", data.data(), data.size());
+    });
+
+    bandsDone += count;
+    if(rows > 0) {
+        std::copy(pixels + (rows - 1) * rowBytes, pixels + rows * rowBytes, previousRow.begin());
+    }
+    size_t kept = std::min<size_t>(buffer.size(), DEFLATE_WINDOW_SIZE);
+    window.assign(buffer.end() - kept, buffer.end());
+}
+
+//! A function variable.
+/*!
+  A function that appends the signature and IHDR: 8 bits per sample, the colour type of the channels, no interlacing.
+*/
+void putPngHeader(std::vector<uint8_t>& out, int w, int h, int channels) {
+    out.insert(out.end(), pngSignature, pngSignature + 8);
+    uint8_t header[13] = {
+        (uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w,
+        (uint8_t)(h >> 24), (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)h,
+        8, colorTypes[channels], 0, 0, 0
+    };
+    putPngChunk(out, "IHDR", header, sizeof(header), pngChunkCrc("IHDR", header, sizeof(header)));
+}
+
+//! A function variable.
+/*!
+  A function that appends the Adler-32 as an IDAT chunk of its own, then IEND.
+*/
+void putPngTrailer(std::vector<uint8_t>& out, uint32_t adler) {
+    uint8_t trailer[4] = {(uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler};
+    putPngChunk(out, "IDAT", trailer, sizeof(trailer), pngChunkCrc("IDAT", trailer, sizeof(trailer)));
+    putPngChunk(out, "IEND", nullptr, 0, pngChunkCrc("IEND", nullptr, 0));
+}
+
+//! A function variable.
+/*!
+  A function that deflates all rows into bands and writes the signature, IHDR, the stBD chunk, one IDAT chunk
+  per band (the first starting with the zlib header), an IDAT chunk with the Adler-32 and IEND.
+  Return type: boolean.
+*/
+bool encodePng(const uint8_t* pixels, int w, int h, int channels, int filter, int matchDepth, std::vector<uint8_t>& out) {
+    if(w <= 0 || h <= 0 || channels < 1 || channels > 4 || filter < PNG_HEURISTIC_FILTER || filter > 4) {
+        return false;
+    }
+    PngBandIndex index;
+    index.rowsPerBand = (uint32_t)pngRowsPerBand(w, channels);
+    index.filter = filter;
+    std::vector<PngBand> bands;
+    PngBandEncoder encoder(w, channels, filter, matchDepth, index.rowsPerBand);
+    encoder.encode(pixels, h, true, bands);
+    for(const PngBand& band : bands) {
+        index.checksums.push_back(band.checksum);
+    }
+    uint32_t adler = index.streamChecksum(w, h, channels);
+
+    size_t total = 8 + 25 + 18 + bands.size() * 4 + 12 + 4 + 12;
+    for(const PngBand& band : bands) {
+        total += band.data.size() + 12;
+    }
+    out.clear();
+    out.reserve(total);
+    putPngHeader(out, w, h, channels);
+    index.put(out);
+    for(const PngBand& band : bands) {
+        putPngChunk(out, "IDAT", band.data.data(), band.data.size(), band.crc);
+    }
+    putPngTrailer(out, adler);
+    return true;
+}
@@ -0,0 +1,136 @@
+//!  A PNG writer module.
+/*!
+  Functions that encode 8-bit images as PNG files on all threads of the stego thread pool. The filtered scanlines
+  are cut into bands of about PNG_BAND_SIZE bytes; every band is deflated on its own, primed with the 32 KB before it,
+  and ends on a byte boundary (see Deflater), so the bands are simply concatenated into one zlib stream whose Adler-32
+  is combined from the checksums of the bands. Every band is stored in an IDAT chunk of its own.
+  The band size does not depend on the number of threads, so the output does not either.
+  A private stBD chunk records the bands, so a later encode can re-deflate only the bands whose rows changed
+  and copy the others (see PngSplice). encodePng writes it before the image data, streamed files after it.
+*/
+
+#ifndef ImageSteganography_PNG_WRITER_H
+#define ImageSteganography_PNG_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define PNG_BAND_SIZE (1 << 20) //!< The number of filtered bytes a band is cut after, rounded up to whole rows.
+#define PNG_HEURISTIC_FILTER -1 //!< The filter choice that picks the filter of every row with the sum of absolute values.
+#define PNG_BAND_INDEX_VERSION 1 //!< The version of the stBD chunk.
+
+//! A structure.
+/*! A structure that stores one deflated band of filtered rows. */
+struct PngBand {
+    std::vector<uint8_t> data; //!< A variable that stores the deflated band, the first band starting with the zlib header.
+    uint32_t checksum = 1; //!< A variable that stores the Adler-32 of the filtered rows of the band.
+    uint32_t crc = 0; //!< A variable that stores the CRC of the IDAT chunk that holds the band.
+};
+
+//! A structure.
+/*!
+  A structure that stores the contents of the stBD chunk: how the image was cut into bands, the filter choice
+  the rows were filtered with and the Adler-32 of every band. Its type is ancillary, private and unsafe to copy,
+  so editors that change the image data drop it.
+*/
+struct PngBandIndex {
+    uint32_t rowsPerBand = 0; //!< A variable that stores the number of rows of every band but the last.
+    int filter = PNG_HEURISTIC_FILTER; //!< A variable that stores the filter choice of the rows (see encodePng).
+    std::vector<uint32_t> checksums; //!< A variable that stores the Adler-32 of the filtered rows of every band.
+
+    //! A function variable.
+    /*!
+      A function that parses the data of an stBD chunk and checks that it describes an image of h rows.
+      Return type: boolean.
+    */
+    bool parse(const uint8_t* data, size_t size, int h);
+
+    //! A function variable.
+    /*!
+      A function that appends the stBD chunk to out.
+    */
+    void put(std::vector<uint8_t>& out) const;
+
+    //! A function variable.
+    /*!
+      A function that returns the Adler-32 of the whole zlib stream of an image of w * h pixels of channels bytes,
+      combined from the checksums of the bands.
+    */
+    uint32_t streamChecksum(int w, int h, int channels) const;
+};
+
+//! A function variable.
+/*!
+  A function that returns how many rows of an image w pixels of channels bytes wide go into one band.
+*/
+size_t pngRowsPerBand(int w, int channels);
+
+//! A class.
+/*!
+  A class that filters and deflates the rows of one image in order, any number of whole bands at a time,
+  so an image can be encoded from a few bands held in memory. It keeps the last row and the last 32 KB of filtered
+  bytes between calls, so the bands come out the same however the rows are handed in.
+*/
+class PngBandEncoder {
+public:
+    //! A constructor.
+    /*!
+      A constructor that takes the image width and channels, the filter choice (see encodePng), the match depth
+      and the number of rows of a band.
+    */
+    PngBandEncoder(int w, int channels, int filter, int matchDepth, size_t rowsPerBand);
+
+    //! A function variable.
+    /*!
+      A function that filters the next rows (rows * w pixels of channels bytes) and deflates them into bands,
+      on the thread pool, replacing the contents of bands. rows has to be a multiple of the band rows unless last
+      tells that these rows end the image; the last band then ends the stream.
+    */
+    void encode(const uint8_t* pixels, int rows, bool last, std::vector<PngBand>& bands);
+
+private:
+    size_t rowBytes; //!< A variable that stores the bytes of a row.
+    size_t step; //!< A variable that stores the bytes of a pixel, the distance of the left neighbour.
+    int filter; //!< A variable that stores the filter choice.
+    int matchDepth; //!< A variable that stores how many hash chain entries a match search compares.
+    size_t rowsPerBand; //!< A variable that stores the number of rows of a band.
+    size_t bandsDone = 0; //!< A variable that stores how many bands were encoded so far.
+    std::vector<uint8_t> previousRow; //!< A variable that stores the last row encoded so far, zeros before the first one.
+    std::vector<uint8_t> window; //!< A variable that stores the last filtered bytes, up to 32 KB, the dictionary of the next band.
+};
+
+//! A function variable.
+/*!
+  A function that returns the CRC of a chunk from its type and data.
+*/
+uint32_t pngChunkCrc(const char* type, const uint8_t* data, size_t size);
+
+//! A function variable.
+/*!
+  A function that appends a chunk: its length, type, data and the CRC, which may have been computed before.
+*/
+void putPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size, uint32_t crc);
+
+//! A function variable.
+/*!
+  A function that appends the PNG signature and the IHDR chunk of an 8-bit image of w * h pixels of channels bytes.
+*/
+void putPngHeader(std::vector<uint8_t>& out, int w, int h, int channels);
+
+//! A function variable.
+/*!
+  A function that appends the IDAT chunk with the Adler-32 that ends the zlib stream, and the IEND chunk.
+*/
+void putPngTrailer(std::vector<uint8_t>& out, uint32_t adler);
+
+//! A function variable.
+/*!
+  A function that encodes the pixels (w * h pixels of channels bytes, 1 to 4 channels) as a PNG file into out.
+  filter is the filter every row uses (0 none, 1 sub, 2 up, 3 average, 4 Paeth) or PNG_HEURISTIC_FILTER,
+  and matchDepth is the number of hash chain entries every match search compares.
+  Return type: boolean.
+*/
+bool encodePng(const uint8_t* pixels, int w, int h, int channels, int filter, int matchDepth, std::vector<uint8_t>& out);
+
+#endif //ImageSteganography_PNG_WRITER_H
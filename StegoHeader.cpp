@@ -0,0 +1,247 @@
+//!  A stego header class.
+/*!
+    Functions that write and read the header in front of the payload.
+*/
+
+#include <cstring>
+
+#include "StegoHeader.h"
+#include "LsbKernels.h"
+
+//! A function variable.
+/*!
+  A function that checks whether the settings can be written by the legacy header.
+  Return type: boolean.
+*/
+bool StegoSettings::isLegacy() const {
+    return bitsPerChannel == 1 && channelMask == 0;
+}
+
+//! A function variable.
+/*!
+  A function that checks the settings against the number of channels and clears a mask that selects all of them.
+  Return type: boolean.
+*/
+bool StegoSettings::normalize(int channels) {
+    if(bitsPerChannel < 1 || bitsPerChannel > STEG_MAX_BITS_PER_CHANNEL) {
+        return false;
+    }
+    if((channelMask >> channels) != 0) {
+        return false;
+    }
+    if(channelMask == (uint8_t)((1 << channels) - 1)) {
+        channelMask = 0;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes the header for the settings and the payload size takes.
+*/
+size_t stegoHeaderSize(const StegoSettings& settings, uint64_t messageSize) {
+    if(settings.isLegacy() && messageSize <= STEG_LEGACY_MAX_MESSAGE_SIZE) {
+        return STEG_HEADER_SIZE;
+    }
+    return settings.channelMask == 0 ? STEG_HEADER_V2_SIZE : STEG_HEADER_V3_SIZE;
+}
+
+//! A function variable.
+/*!
+  A function that returns the offset of the payload in the carrier.
+  A masked header spans the pixels whose selected channels hold its bits.
+*/
+size_t stegoPayloadOffset(const StegoSettings& settings, int channels, uint64_t messageSize) {
+    size_t headerSize = stegoHeaderSize(settings, messageSize);
+    if(settings.channelMask == 0) {
+        return headerSize;
+    }
+    return pixelsForPayload(selectedChannels(channels, settings.channelMask), 1, headerSize / 8) * channels;
+}
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes the header and a payload of messageSize bytes take together.
+  Payloads whose bit count overflows 64 bits can never fit and return UINT64_MAX.
+*/
+uint64_t stegoCapacityNeeded(const StegoSettings& settings, int channels, uint64_t messageSize) {
+    if(messageSize > UINT64_MAX / 16) {
+        return UINT64_MAX;
+    }
+    uint64_t offset = stegoPayloadOffset(settings, channels, messageSize);
+    uint64_t carrierBytes = (messageSize * 8 + settings.bitsPerChannel - 1) / settings.bitsPerChannel;
+    if(settings.channelMask == 0) {
+        return offset + carrierBytes;
+    }
+    uint64_t selected = selectedChannels(channels, settings.channelMask);
+    return offset + (carrierBytes + selected - 1) / selected * channels;
+}
+
+//! A function variable.
+/*!
+  A function that stores the low `bytes` bytes of the value in the buffer, most significant byte first.
+*/
+static void putBigEndian(uint8_t* buffer, uint64_t value, int bytes) {
+    for(int i = 0; i < bytes; ++i) {
+        buffer[i] = (uint8_t)(value >> (8 * (bytes - 1 - i)));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that loads a value of `bytes` bytes stored most significant byte first.
+*/
+static uint64_t getBigEndian(const uint8_t* buffer, int bytes) {
+    uint64_t value = 0;
+    for(int i = 0; i < bytes; ++i) {
+        value = (value << 8) | buffer[i];
+    }
+    return value;
+}
+
+//! A function variable.
+/*!
+  A function that reads the header through the mask, which selects some but not all of the channels.
+  It is taken when the bytes read through the mask start with the version 3 magic word and name that same mask,
+  which the bits of any other header match only by chance.
+  Return type: boolean.
+*/
+static bool readMaskedHeader(const uint8_t* carrier, size_t carrierSize, int channels, uint8_t mask, uint8_t* buffer) {
+    StegoSettings settings;
+    settings.channelMask = mask;
+    if(stegoPayloadOffset(settings, channels, 0) > carrierSize) {
+        return false;
+    }
+    extractBitsMasked(channels, mask, 1, buffer, carrier, STEG_HEADER_V3_SIZE / 8);
+    return getBigEndian(buffer, 4) == STEG_MAGIC_V3 && (buffer[4] >> 4) == mask;
+}
+
+//! A function variable.
+/*!
+  A function that looks for version 3 headers in the carrier by reading it through every mask, copies the newest one
+  to the buffer and returns its mask, or 0 when there is none.
+*/
+static uint8_t findMaskedHeader(const uint8_t* carrier, size_t carrierSize, int channels, uint8_t* buffer) {
+    uint8_t newest = 0;
+    uint64_t newestSequence = 0;
+    if(channels < 2 || channels > STEG_MAX_CHANNELS) {
+        return 0;
+    }
+    for(int m = 1; m < (1 << channels) - 1; ++m) {
+        uint8_t candidate[STEG_HEADER_V3_SIZE / 8];
+        if(!readMaskedHeader(carrier, carrierSize, channels, (uint8_t)m, candidate)) {
+            continue;
+        }
+        uint64_t sequence = getBigEndian(candidate + 5, 4);
+        if(newest == 0 || sequence > newestSequence) {
+            newest = (uint8_t)m;
+            newestSequence = sequence;
+            memcpy(buffer, candidate, sizeof(candidate));
+        }
+    }
+    return newest;
+}
+
+//! A function variable.
+/*!
+  A function that embeds the header into the carrier and returns its size in carrier bytes.
+  The legacy header is the length in bits. The version 2 header is the magic word,
+  a parameter byte holding the bits per channel (low nibble) and the channel mask (high nibble) and the 64-bit length in bits;
+  the version 3 header has a 32-bit sequence number between the parameter byte and the length.
+  A version 3 header is numbered one past the newest one in the carrier, whose channels may not overlap its own;
+  a header in all channels clears every version 3 header before it is embedded, since it may overwrite only part of them.
+*/
+size_t writeStegoHeader(uint8_t* carrier, size_t carrierSize, const StegoSettings& settings, int channels, uint64_t messageSize) {
+    uint8_t header[STEG_HEADER_V3_SIZE / 8];
+    uint8_t found = findMaskedHeader(carrier, carrierSize, channels, header);
+    if(settings.channelMask != 0) {
+        uint32_t sequence = found != 0 ? (uint32_t)getBigEndian(header + 5, 4) + 1 : 0;
+        putBigEndian(header, STEG_MAGIC_V3, 4);
+        header[4] = (uint8_t)(settings.bitsPerChannel | (settings.channelMask << 4));
+        putBigEndian(header + 5, sequence, 4);
+        putBigEndian(header + 9, messageSize * 8, 8);
+        embedBitsMasked(channels, settings.channelMask, 1, carrier, header, sizeof(header));
+        return stegoPayloadOffset(settings, channels, messageSize);
+    }
+    for(int m = 1; found != 0 && m < (1 << channels) - 1; ++m) {
+        if(readMaskedHeader(carrier, carrierSize, channels, (uint8_t)m, header)) {
+            memset(header, 0, sizeof(header));
+            embedBitsMasked(channels, (uint8_t)m, 1, carrier, header, sizeof(header));
+        }
+    }
+    if(stegoHeaderSize(settings, messageSize) == STEG_HEADER_SIZE) {
+        putBigEndian(header, messageSize * 8, 4);
+        embedBits(carrier, header, STEG_HEADER_SIZE / 8);
+        return STEG_HEADER_SIZE;
+    }
+    putBigEndian(header, STEG_MAGIC_V2, 4);
+    header[4] = (uint8_t)settings.bitsPerChannel;
+    putBigEndian(header + 5, messageSize * 8, 8);
+    embedBits(carrier, header, STEG_HEADER_V2_SIZE / 8);
+    return STEG_HEADER_V2_SIZE;
+}
+
+//! A function variable.
+/*!
+  A function that reads the header from the carrier.
+  Version 3 headers are looked for first, since the masked channels they are read from say nothing about the others,
+  and the newest one is taken.
+  Otherwise the first 32 bits are either a legacy length or the magic word of a version 2 header.
+  The payload has to fit behind the header, which itself may be longer than a small carrier.
+  Return type: boolean.
+*/
+bool readStegoHeader(const uint8_t* carrier, size_t carrierSize, int channels, StegoHeader& header) {
+    uint8_t buffer[STEG_HEADER_V3_SIZE / 8];
+    if(carrierSize < STEG_HEADER_SIZE) {
+        return false;
+    }
+    uint64_t first = 0;
+    uint64_t lengthBits = 0;
+    uint8_t mask = findMaskedHeader(carrier, carrierSize, channels, buffer);
+    bool masked = mask != 0;
+    if(!masked) {
+        extractBits(buffer, carrier, STEG_HEADER_SIZE / 8);
+        first = getBigEndian(buffer, 4);
+    }
+
+    if(masked) {
+        lengthBits = getBigEndian(buffer + 9, 8);
+        header.settings.bitsPerChannel = buffer[4] & 0x0F;
+        header.settings.channelMask = mask;
+        if(!header.settings.normalize(channels)) {
+            return false;
+        }
+        header.headerSize = stegoPayloadOffset(header.settings, channels, 0);
+    }
+    else if(first == STEG_MAGIC_V2) {
+        size_t headerSize = STEG_HEADER_V2_SIZE;
+        if(carrierSize < headerSize) {
+            return false;
+        }
+        extractBits(buffer, carrier, headerSize / 8);
+        lengthBits = getBigEndian(buffer + 5, 8);
+        header.settings.bitsPerChannel = buffer[4] & 0x0F;
+        header.settings.channelMask = buffer[4] >> 4;
+        if(!header.settings.normalize(channels)) {
+            return false;
+        }
+        header.headerSize = headerSize;
+    }
+    else {
+        lengthBits = first;
+        header.settings = StegoSettings();
+        header.headerSize = STEG_HEADER_SIZE;
+    }
+    if(lengthBits % 8 != 0 || lengthBits / 8 > carrierSize) {
+        return false;
+    }
+    header.messageSize = lengthBits / 8;
+    header.payloadOffset = header.headerSize;
+    if(header.settings.channelMask != 0) {
+        header.payloadOffset = (header.headerSize + channels - 1) / channels * channels;
+    }
+    if(header.payloadOffset > carrierSize) {
+        return false;
+    }
+    return stegoCapacityNeeded(header.settings, channels, header.messageSize) <= carrierSize;
+}
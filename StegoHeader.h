@@ -0,0 +1,103 @@
+//!  A stego header class.
+/*!
+  Structures with the embedding settings and the header in front of the payload, and functions that write and read the header.
+  The header is always embedded 1 bit per carrier byte, so it can be read before the settings are known.
+  The legacy header is the payload length in bits as a 32-bit number, which is always a multiple of 8.
+  The versioned headers start with a magic word whose low 3 bits are not zero, so they can never be mistaken for a legacy length.
+  Version 2 stores the length in bits as a 64-bit number.
+  Version 3 adds a 32-bit sequence number after the parameter byte and is embedded only into the channels selected by its channel mask,
+  so a mask leaves the other channels untouched; it is found by reading the header through every mask.
+  A header of another mask survives such an embedding, so every version 3 header is numbered one past the newest
+  one already in the carrier and the reader takes the newest; a header embedded into all channels clears them instead.
+*/
+
+#ifndef ImageSteganography_STEGO_HEADER_H
+#define ImageSteganography_STEGO_HEADER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define STEG_HEADER_SIZE sizeof(uint32_t) * 8
+#define STEG_MAGIC_V2 0x53544702 //!< "STG" followed by the header version 2.
+#define STEG_MAGIC_V3 0x53544703 //!< "STG" followed by the header version 3.
+#define STEG_HEADER_V2_SIZE (sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t)) * 8
+#define STEG_HEADER_V3_SIZE (sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint64_t)) * 8
+#define STEG_LEGACY_MAX_MESSAGE_SIZE (UINT32_MAX / 8) //!< The largest payload, in bytes, a 32-bit length in bits can describe.
+#define STEG_MAX_BITS_PER_CHANNEL 4
+#define STEG_MAX_CHANNELS 4
+#define STEG_HEADER_READ_SIZE (STEG_HEADER_V3_SIZE * STEG_MAX_CHANNELS) //!< The most carrier bytes a header can span: version 3 in 1 of 4 channels.
+
+//! A structure.
+/*! A structure that stores the settings the payload is embedded with. */
+struct StegoSettings {
+    int bitsPerChannel = 1; //!< A variable that stores how many low bits of every carrier byte hold the payload (1-4).
+    uint8_t channelMask = 0; //!< A variable that stores which channels are carriers, bit c for channel c (0 means all of them).
+
+    //! A function variable.
+    /*!
+      A function that checks whether the settings can be written by the legacy header,
+      which only knows 1 bit per channel in every channel (and payloads up to 512 MB).
+      Return type: boolean.
+    */
+    bool isLegacy() const;
+
+    //! A function variable.
+    /*!
+      A function that checks the settings against an image with the given number of channels.
+      A mask that selects every channel is stored as 0, so it does not need the versioned header.
+      Return type: boolean.
+    */
+    bool normalize(int channels);
+};
+
+//! A structure.
+/*! A structure that stores the contents of a header read from the carrier. */
+struct StegoHeader {
+    StegoSettings settings; //!< A variable that stores the settings the payload was embedded with.
+    size_t messageSize = 0; //!< A variable that stores the payload size in bytes.
+    size_t headerSize = 0; //!< A variable that stores how many carrier bytes the header takes.
+    size_t payloadOffset = 0; //!< A variable that stores the offset of the first payload byte in the carrier.
+};
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes of the channels that hold it the header for the settings
+  and a payload of messageSize bytes takes.
+*/
+size_t stegoHeaderSize(const StegoSettings& settings, uint64_t messageSize);
+
+//! A function variable.
+/*!
+  A function that returns the offset of the payload in the carrier.
+  With a channel mask the payload starts at the first pixel after the header.
+*/
+size_t stegoPayloadOffset(const StegoSettings& settings, int channels, uint64_t messageSize);
+
+//! A function variable.
+/*!
+  A function that returns how many carrier bytes the header and a payload of messageSize bytes take together.
+  It returns UINT64_MAX when the count does not fit in 64 bits.
+*/
+uint64_t stegoCapacityNeeded(const StegoSettings& settings, int channels, uint64_t messageSize);
+
+//! A function variable.
+/*!
+  A function that embeds the header for the settings and the payload size into a carrier of carrierSize bytes
+  and returns its size in carrier bytes.
+  Default settings with a payload up to 512 MB get the legacy header, so older builds can still decode the image;
+  settings with a channel mask get the version 3 header, embedded into the selected channels of pixels with
+  the given number of channels, and everything else gets the version 2 header.
+  The version 3 headers already in the first STEG_HEADER_READ_SIZE bytes of the carrier are read first,
+  so the carrier must hold that many bytes when the image does.
+*/
+size_t writeStegoHeader(uint8_t* carrier, size_t carrierSize, const StegoSettings& settings, int channels, uint64_t messageSize);
+
+//! A function variable.
+/*!
+  A function that reads the header from a carrier of carrierSize bytes with the given number of channels.
+  It reads the legacy, version 2 and version 3 headers, and the newest of several version 3 headers. It fails when the header is malformed or the payload it announces does not fit in the carrier.
+  Return type: boolean.
+*/
+bool readStegoHeader(const uint8_t* carrier, size_t carrierSize, int channels, StegoHeader& header);
+
+#endif //ImageSteganography_STEGO_HEADER_H
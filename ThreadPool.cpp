@@ -0,0 +1,138 @@
+//!  A thread pool class.
+/*!
+    A class with worker threads that run indexed tasks, and the pool shared by the stego kernels.
+*/
+
+#include <memory>
+
+#include "ThreadPool.h"
+
+//! A constructor.
+/*!
+  A constructor that starts threads - 1 workers; the caller of parallelFor is the last thread.
+*/
+ThreadPool::ThreadPool(unsigned threads) {
+    for(unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+//! A destructor.
+/*!
+  A destructor that stops and joins the workers.
+*/
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the total number of threads.
+*/
+unsigned ThreadPool::size() const {
+    return (unsigned)workers.size() + 1;
+}
+
+//! A function variable.
+/*!
+  A function that runs task(i) for every i in [0, count) on the workers and the calling thread.
+  The caller waits until every worker left the loop, so the next loop can never mix with this one.
+*/
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& loopTask) {
+    if(workers.empty() || count <= 1) {
+        for(size_t i = 0; i < count; ++i) {
+            loopTask(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &loopTask;
+        taskCount = count;
+        nextTask = 0;
+        busyWorkers = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    task = nullptr;
+}
+
+//! A function variable.
+/*!
+  A function that takes task indexes until the current loop is exhausted.
+*/
+void ThreadPool::runTasks() {
+    for(size_t i = nextTask++; i < taskCount; i = nextTask++) {
+        (*task)(i);
+    }
+}
+
+//! A function variable.
+/*!
+  A function that waits for a new loop, helps running it and reports back.
+*/
+void ThreadPool::workerLoop() {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if(stopping) {
+            return;
+        }
+        seen = generation;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+        if(--busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+static unsigned configuredThreads = 0; //!< The number of threads set with setStegoThreadCount, 0 for the default.
+static std::unique_ptr<ThreadPool> sharedPool; //!< The pool shared by the stego kernels.
+
+//! A function variable.
+/*!
+  A function that returns the number of threads the stego kernels use.
+*/
+unsigned stegoThreadCount() {
+    if(configuredThreads != 0) {
+        return configuredThreads;
+    }
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware != 0 ? hardware : 1;
+}
+
+//! A function variable.
+/*!
+  A function that sets the number of threads the stego kernels use and drops a pool of another size.
+*/
+void setStegoThreadCount(unsigned threads) {
+    configuredThreads = threads;
+    if(sharedPool != nullptr && sharedPool->size() != stegoThreadCount()) {
+        sharedPool.reset();
+    }
+}
+
+//! A function variable.
+/*!
+  A function that returns the thread pool shared by the stego kernels.
+*/
+ThreadPool& stegoThreadPool() {
+    if(sharedPool == nullptr) {
+        sharedPool.reset(new ThreadPool(stegoThreadCount()));
+    }
+    return *sharedPool;
+}
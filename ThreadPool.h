@@ -0,0 +1,94 @@
+//!  A thread pool class.
+/*!
+  A class with a fixed set of worker threads that run indexed tasks, and functions that configure the pool
+  shared by the stego kernels.
+*/
+
+#ifndef ImageSteganography_THREAD_POOL_H
+#define ImageSteganography_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! A class.
+/*! A class that keeps threads - 1 workers alive and runs parallel loops on them together with the calling thread. */
+class ThreadPool {
+public:
+    //! A constructor.
+    /*!
+      A constructor that takes the total number of threads, the calling thread included.
+    */
+    explicit ThreadPool(unsigned threads);
+
+    //! A destructor.
+    /*!
+      A destructor that stops and joins the workers.
+    */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! A function variable.
+    /*!
+      A function that returns the total number of threads, the calling thread included.
+    */
+    unsigned size() const;
+
+    //! A function variable.
+    /*!
+      A function that runs task(i) for every i in [0, count) and returns when all of them finished.
+      Tasks are handed out in index order, but may finish in any order, so they must write disjoint data.
+      It must not be called from two threads at once.
+    */
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    //! A function variable.
+    /*!
+      A function that takes task indexes until the current loop is exhausted.
+    */
+    void runTasks();
+
+    //! A function variable.
+    /*!
+      A function that is the body of every worker thread.
+    */
+    void workerLoop();
+
+    std::vector<std::thread> workers; //!< A variable that stores the worker threads.
+    std::mutex mutex; //!< A variable that guards the loop state below.
+    std::condition_variable wake; //!< A variable that wakes the workers for a new loop or for stopping.
+    std::condition_variable finished; //!< A variable that wakes the caller when every worker left the loop.
+    const std::function<void(size_t)>* task = nullptr; //!< A variable that stores the task of the current loop.
+    size_t taskCount = 0; //!< A variable that stores the number of tasks of the current loop.
+    std::atomic<size_t> nextTask{0}; //!< A variable that stores the next task index to hand out.
+    size_t busyWorkers = 0; //!< A variable that stores how many workers are still in the current loop.
+    unsigned generation = 0; //!< A variable that stores the number of the current loop.
+    bool stopping = false; //!< A variable that tells the workers to exit.
+};
+
+//! A function variable.
+/*!
+  A function that returns the number of threads the stego kernels use (hardware concurrency by default).
+*/
+unsigned stegoThreadCount();
+
+//! A function variable.
+/*!
+  A function that sets the number of threads the stego kernels use; 0 restores the default.
+*/
+void setStegoThreadCount(unsigned threads);
+
+//! A function variable.
+/*!
+  A function that returns the thread pool shared by the stego kernels, created on first use.
+*/
+ThreadPool& stegoThreadPool();
+
+#endif //ImageSteganography_THREAD_POOL_H
@@ -0,0 +1,233 @@
+//!  An inflate test.
+/*!
+  A program that inflates known zlib streams (a stored, a fixed and a dynamic block, and runs of matches that
+  overlap the bytes they copy) and long streams of the Deflater with the Inflater, pulling the input a few bytes
+  at a time and reading the output in pieces of several sizes, and checks the output byte for byte.
+  Every stream is also cut short at many points, where the output has to be a prefix of the expected one
+  and the inflater has to report the failure.
+  Build it from the repository root with
+  g++ -std=c++17 -I. tests/InflateTest.cpp Inflate.cpp Deflate.cpp CpuFeatures.cpp -o inflate-test
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Deflate.h"
+#include "Inflate.h"
+
+//! A structure.
+/*! A structure that stores a zlib stream and the bytes it inflates to. */
+struct KnownStream {
+    const char* name; //!< A variable that stores what the stream covers.
+    std::vector<uint8_t> compressed; //!< A variable that stores the zlib stream.
+    std::vector<uint8_t> expected; //!< A variable that stores the inflated bytes.
+};
+
+//! A function variable.
+/*!
+  A function that returns the bytes of the string.
+*/
+static std::vector<uint8_t> bytesOf(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+//! A function variable.
+/*!
+  A function that returns the zlib streams, made with zlib 1.2.13, and the bytes they inflate to.
+*/
+static std::vector<KnownStream> knownStreams() {
+    std::vector<KnownStream> streams;
+    streams.push_back({"stored block",
+                       {0x78, 0x01, 0x01, 0x2b, 0x00, 0xd4, 0xff, 0x41, 0x20, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20,
+                        0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x6b, 0x65, 0x65, 0x70, 0x73, 0x20, 0x69, 0x74, 0x73, 0x20,
+                        0x62, 0x79, 0x74, 0x65, 0x73, 0x20, 0x61, 0x73, 0x20, 0x74, 0x68, 0x65, 0x79, 0x20, 0x61, 0x72,
+                        0x65, 0x2e, 0x53, 0xfe, 0x0f, 0x61},
+                       bytesOf("A stored block keeps its bytes as they are.")});
+    streams.push_back({"fixed block",
+                       {0x78, 0x01, 0x4b, 0x4c, 0x2a, 0x4a, 0x4c, 0x4e, 0x4c, 0x49, 0x04, 0x52, 0x3a, 0x0a, 0x89, 0x38,
+                        0x38, 0x8a, 0x00, 0x0f, 0xbf, 0x0d, 0xb6},
+                       bytesOf("abracadabra, abracadabra, abracadabra!")});
+    streams.push_back({"dynamic block",
+                       {0x78, 0xda, 0x55, 0x8f, 0xeb, 0x6d, 0x04, 0x31, 0x08, 0x84, 0x5b, 0xa1, 0x80, 0xd3, 0x35, 0x93,
+                        0x34, 0xc0, 0xc6, 0xd8, 0x46, 0x6b, 0xc3, 0xc9, 0x20, 0x6d, 0xdc, 0x7d, 0x58, 0xf2, 0x90, 0xf2,
+                        0x13, 0xbe, 0x61, 0x66, 0x78, 0x73, 0x6a, 0x28, 0xda, 0x16, 0xbe, 0xfa, 0x86, 0xce, 0x85, 0x0c,
+                        0x10, 0x26, 0x99, 0x61, 0x23, 0x60, 0x01, 0xef, 0x04, 0x83, 0xd0, 0x1c, 0x8c, 0x9b, 0x70, 0xe5,
+                        0x0f, 0x14, 0x87, 0x83, 0xdd, 0x40, 0x6b, 0xd2, 0x17, 0x7f, 0xd2, 0xc8, 0x09, 0x05, 0x78, 0xc6,
+                        0xdd, 0x03, 0x4c, 0x13, 0xe5, 0x04, 0x43, 0xf5, 0xb4, 0x9c, 0x0d, 0x27, 0x81, 0x6b, 0x08, 0xb7,
+                        0x0a, 0xc1, 0xd5, 0x15, 0x8a, 0x46, 0xa2, 0xa8, 0xc3, 0x29, 0x7a, 0xa5, 0xe8, 0x2f, 0x3c, 0x6f,
+                        0x16, 0x3d, 0xe1, 0x3d, 0xb6, 0x9d, 0xb0, 0xd0, 0xba, 0x1b, 0xd5, 0xa5, 0xd1, 0xe0, 0x37, 0x1c,
+                        0xf7, 0x50, 0x2c, 0xe1, 0xbc, 0x0d, 0x7a, 0x38, 0x0c, 0x95, 0xf6, 0x8f, 0x84, 0x0d, 0x4a, 0x49,
+                        0xc6, 0x0e, 0x17, 0x1a, 0xd0, 0x3c, 0xa8, 0x14, 0x2a, 0x8f, 0x04, 0xb7, 0x76, 0x7d, 0x9b, 0x3b,
+                        0x9e, 0x51, 0x26, 0x54, 0x11, 0x31, 0x13, 0x54, 0x5e, 0xf1, 0xf9, 0xcf, 0x87, 0x07, 0x55, 0x5d,
+                        0x74, 0xf3, 0x5b, 0x7f, 0xdb, 0x6e, 0xef, 0x1c, 0x71, 0x01, 0xe9, 0xf9, 0x05, 0xf6, 0xb9, 0x76,
+                        0xc7},
+                       bytesOf("Steganography hides a message in the least significant bits of the pixels of an image, "
+                               "so the image looks the same to anyone who does not know the message is there. "
+                               "The header in front of the payload says how long the payload is and how it was embedded, "
+                               "and the reader takes it from the first pixels before it reads anything else.")});
+    std::string runs = std::string(600, 'a');
+    for(int i = 0; i < 200; ++i) {
+        runs += "abc";
+    }
+    for(int i = 0; i < 100; ++i) {
+        runs += "xyzzy";
+    }
+    streams.push_back({"overlapping matches",
+                       {0x78, 0xda, 0x4b, 0x4c, 0x1c, 0x05, 0xa3, 0x80, 0x06, 0x20, 0x29, 0x79, 0x14, 0x8d, 0x22, 0xaa,
+                        0xa3, 0x8a, 0xca, 0xaa, 0xaa, 0xca, 0x51, 0x62, 0x44, 0x11, 0x00, 0x1a, 0x46, 0xb5, 0xdf},
+                       bytesOf(runs)});
+    return streams;
+}
+
+//! A function variable.
+/*!
+  A function that returns a zlib stream of the Deflater for the data, compressed in pieces of pieceSize bytes
+  that refer back to the 32 KB before them, and followed by the Adler-32 checksum.
+*/
+static std::vector<uint8_t> deflateStream(const std::vector<uint8_t>& data, int matchDepth, size_t pieceSize) {
+    std::vector<uint8_t> out = {0x78, 0x01};
+    Deflater deflater(matchDepth);
+    for(size_t begin = 0; begin < data.size(); begin += pieceSize) {
+        size_t size = std::min(pieceSize, data.size() - begin);
+        size_t dictionary = std::min<size_t>(begin, DEFLATE_WINDOW_SIZE);
+        deflater.compress(data.data() + begin, dictionary, size, begin + size == data.size(), out);
+    }
+    uint32_t adler = adler32(1, data.data(), data.size());
+    for(int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(adler >> shift));
+    }
+    return out;
+}
+
+//! A function variable.
+/*!
+  A function that returns about size bytes of text with long and short repeats, runs of one byte that matches
+  at distance 1 copy over themselves, and a stretch of random bytes the Deflater has to store.
+*/
+static std::vector<uint8_t> longData(std::mt19937& random, size_t size) {
+    const char* words[] = {"pixel ", "channel ", "payload ", "header ", "mask ", "bits ", "row ", "band "};
+    std::vector<uint8_t> data;
+    while(data.size() < size) {
+        uint32_t choice = random() % 16;
+        if(choice == 0) {
+            data.insert(data.end(), 300 + random() % 700, (uint8_t)random());
+        }
+        else if(choice == 1 && data.size() > 0 && data.size() < size / 2) {
+            for(int i = 0; i < 2000; ++i) {
+                data.push_back((uint8_t)random());
+            }
+        }
+        else {
+            const char* word = words[random() % 8];
+            data.insert(data.end(), word, word + strlen(word));
+        }
+    }
+    return data;
+}
+
+//! A function variable.
+/*!
+  A function that inflates the first `available` bytes of the stream, handing the inflater at most sourceStep bytes
+  per call and reading the output readStep bytes at a time, and returns what it produced.
+*/
+static std::vector<uint8_t> inflate(const std::vector<uint8_t>& compressed, size_t available, size_t sourceStep,
+                                    size_t readStep, bool& failed, bool& finished) {
+    size_t offset = 0;
+    Inflater inflater([&](uint8_t* buffer, size_t size) {
+        size_t count = std::min(std::min(size, sourceStep), available - offset);
+        memcpy(buffer, compressed.data() + offset, count);
+        offset += count;
+        return count;
+    });
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> piece(readStep);
+    for(;;) {
+        size_t count = inflater.read(piece.data(), readStep);
+        out.insert(out.end(), piece.begin(), piece.begin() + count);
+        if(count < readStep) {
+            break;
+        }
+    }
+    failed = inflater.failed();
+    finished = inflater.finished();
+    return out;
+}
+
+//! A function variable.
+/*!
+  A function that inflates the whole stream with every combination of the steps and checks the output.
+  Return type: boolean.
+*/
+static bool inflatesWhole(const char* name, const std::vector<uint8_t>& compressed, const std::vector<uint8_t>& expected) {
+    const size_t sourceSteps[] = {1, 3, 4096, INFLATE_INPUT_SIZE};
+    const size_t readSteps[] = {1, 7, 4096, INFLATE_CHUNK_SIZE + 1};
+    for(size_t sourceStep : sourceSteps) {
+        for(size_t readStep : readSteps) {
+            if(expected.size() > 100000 && (sourceStep < 4096 || readStep < 4096)) {
+                continue;
+            }
+            bool failed = false;
+            bool finished = false;
+            std::vector<uint8_t> out = inflate(compressed, compressed.size(), sourceStep, readStep, failed, finished);
+            if(failed || !finished || out != expected) {
+                printf("%s, input %zu and output %zu bytes at a time: %zu of %zu bytes, %s\n", name, sourceStep, readStep,
+                       out.size(), expected.size(), failed ? "failed" : finished ? "wrong bytes" : "not finished");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that inflates the stream cut to `available` bytes, before the end of its deflate data,
+  and checks that the output is a prefix of the expected one and that the inflater failed.
+  Return type: boolean.
+*/
+static bool inflatesTruncated(const char* name, const std::vector<uint8_t>& compressed, size_t available,
+                              const std::vector<uint8_t>& expected) {
+    bool failed = false;
+    bool finished = false;
+    std::vector<uint8_t> out = inflate(compressed, available, 4096, 4096, failed, finished);
+    bool prefix = out.size() <= expected.size() && std::equal(out.begin(), out.end(), expected.begin());
+    if(!prefix || !failed || finished) {
+        printf("%s cut to %zu of %zu bytes: %zu bytes out, %s\n", name, available, compressed.size(), out.size(),
+               !prefix ? "not a prefix of the expected bytes" : finished ? "finished" : "no failure reported");
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    int failures = 0;
+    int checks = 0;
+    for(const KnownStream& stream : knownStreams()) {
+        failures += inflatesWhole(stream.name, stream.compressed, stream.expected) ? 0 : 1;
+        checks++;
+        for(size_t available = 0; available + 4 < stream.compressed.size(); ++available) {
+            failures += inflatesTruncated(stream.name, stream.compressed, available, stream.expected) ? 0 : 1;
+            checks++;
+        }
+    }
+
+    std::mt19937 random(2024);
+    const int depths[] = {1, 16, 128};
+    for(int depth : depths) {
+        std::vector<uint8_t> data = longData(random, 300000);
+        std::vector<uint8_t> compressed = deflateStream(data, depth, 65536);
+        failures += inflatesWhole("Deflater stream", compressed, data) ? 0 : 1;
+        checks++;
+        for(int cut = 0; cut < 50; ++cut) {
+            size_t available = random() % (compressed.size() - 4);
+            failures += inflatesTruncated("Deflater stream", compressed, available, data) ? 0 : 1;
+            checks++;
+        }
+    }
+    printf("%d of %d inflate checks failed\n", failures, checks);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+//!  A masked header test.
+/*!
+  A program that embeds a stego header and a payload through every channel mask of 2, 3 and 4 channel pixels,
+  reads them back and checks that the channels the mask leaves out are byte for byte the same as before.
+  It then embeds messages one after another into the same pixels through every pair of masks and checks
+  that the last one is read back, whatever the earlier ones left in the channels it does not use.
+  Build it from the repository root with
+  g++ -std=c++17 -I. tests/MaskedHeaderTest.cpp StegoHeader.cpp LsbKernels.cpp CpuFeatures.cpp -o masked-header-test
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "LsbKernels.h"
+#include "StegoHeader.h"
+
+//! A function variable.
+/*!
+  A function that embeds a payload of payloadSize bytes with the settings into random pixels and checks the round trip.
+  Return type: boolean.
+*/
+static bool roundTrip(std::mt19937& random, int channels, const StegoSettings& settings, size_t payloadSize) {
+    std::vector<uint8_t> payload(payloadSize);
+    for(uint8_t& byte : payload) {
+        byte = (uint8_t)random();
+    }
+    uint64_t needed = stegoCapacityNeeded(settings, channels, payloadSize);
+    std::vector<uint8_t> original((size_t)needed + 64 * channels);
+    for(uint8_t& byte : original) {
+        byte = (uint8_t)random();
+    }
+    std::vector<uint8_t> pixels = original;
+
+    writeStegoHeader(pixels.data(), pixels.size(), settings, channels, payloadSize);
+    embedBitsMasked(channels, settings.channelMask, settings.bitsPerChannel,
+                    pixels.data() + stegoPayloadOffset(settings, channels, payloadSize), payload.data(), payloadSize);
+
+    for(size_t i = 0; i < pixels.size(); ++i) {
+        int channel = (int)(i % channels);
+        if(settings.channelMask != 0 && (settings.channelMask >> channel & 1) == 0 && pixels[i] != original[i]) {
+            printf("%d channels, mask %d: unselected byte %zu changed\n", channels, settings.channelMask, i);
+            return false;
+        }
+    }
+
+    StegoHeader header;
+    if(!readStegoHeader(pixels.data(), pixels.size(), channels, header)) {
+        printf("%d channels, mask %d: no header found\n", channels, settings.channelMask);
+        return false;
+    }
+    if(header.settings.channelMask != settings.channelMask || header.settings.bitsPerChannel != settings.bitsPerChannel
+       || header.messageSize != payloadSize) {
+        printf("%d channels, mask %d: header read back with mask %d, %d bits and %zu bytes\n", channels,
+               settings.channelMask, header.settings.channelMask, header.settings.bitsPerChannel, header.messageSize);
+        return false;
+    }
+    std::vector<uint8_t> extracted(payloadSize);
+    extractBitsMasked(channels, header.settings.channelMask, header.settings.bitsPerChannel, extracted.data(),
+                      pixels.data() + header.payloadOffset, payloadSize);
+    if(extracted != payload) {
+        printf("%d channels, mask %d: payload differs\n", channels, settings.channelMask);
+        return false;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that embeds the message with the settings into the pixels, as an encoding of the image does.
+*/
+static void embedMessage(std::vector<uint8_t>& pixels, int channels, const StegoSettings& settings, const char* message) {
+    size_t size = strlen(message);
+    writeStegoHeader(pixels.data(), pixels.size(), settings, channels, size);
+    embedBitsMasked(channels, settings.channelMask, settings.bitsPerChannel,
+                    pixels.data() + stegoPayloadOffset(settings, channels, size), (const uint8_t*)message, size);
+}
+
+//! A function variable.
+/*!
+  A function that reads the message back from the pixels and compares it with the expected one.
+  Return type: boolean.
+*/
+static bool readsBack(const std::vector<uint8_t>& pixels, int channels, const char* expected) {
+    StegoHeader header;
+    if(!readStegoHeader(pixels.data(), pixels.size(), channels, header)) {
+        printf("%d channels: no header found, expected %s\n", channels, expected);
+        return false;
+    }
+    std::vector<char> message(header.messageSize + 1, 0);
+    extractBitsMasked(channels, header.settings.channelMask, header.settings.bitsPerChannel, (uint8_t*)message.data(),
+                      pixels.data() + header.payloadOffset, header.messageSize);
+    if(strcmp(message.data(), expected) != 0) {
+        printf("%d channels: read %s, expected %s\n", channels, message.data(), expected);
+        return false;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that embeds FIRSTMESSAGE through the first settings, then second through the next ones, and so on,
+  and checks after every embedding that the newest message is the one read back.
+  Return type: boolean.
+*/
+static bool reembed(std::mt19937& random, int channels, const std::vector<StegoSettings>& sequence) {
+    const char* messages[] = {"FIRSTMESSAGE", "second", "third message"};
+    std::vector<uint8_t> pixels(4096);
+    for(uint8_t& byte : pixels) {
+        byte = (uint8_t)random();
+    }
+    for(size_t i = 0; i < sequence.size(); ++i) {
+        embedMessage(pixels, channels, sequence[i], messages[i % 3]);
+        if(!readsBack(pixels, channels, messages[i % 3])) {
+            printf("%d channels: embedding %zu of masks", channels, i + 1);
+            for(const StegoSettings& settings : sequence) {
+                printf(" %d", settings.channelMask);
+            }
+            printf(" failed\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 random(2024);
+    const size_t payloadSizes[] = {0, 1, 11, 100, 4097};
+    int failures = 0;
+    int checks = 0;
+    for(int channels = 2; channels <= STEG_MAX_CHANNELS; ++channels) {
+        for(int mask = 0; mask < (1 << channels) - 1; ++mask) {
+            for(int bits = 1; bits <= STEG_MAX_BITS_PER_CHANNEL; ++bits) {
+                for(size_t payloadSize : payloadSizes) {
+                    StegoSettings settings;
+                    settings.bitsPerChannel = bits;
+                    settings.channelMask = (uint8_t)mask;
+                    failures += roundTrip(random, channels, settings, payloadSize) ? 0 : 1;
+                    checks++;
+                }
+            }
+        }
+    }
+    printf("%d of %d round trips failed\n", failures, checks);
+
+    // -e b.bmp FIRSTMESSAGE -m 0, then -e b.bmp second -m 1, then -d b.bmp.
+    std::vector<StegoSettings> sequence(2);
+    sequence[0].channelMask = 1;
+    sequence[1].channelMask = 2;
+    int reembedFailures = reembed(random, 3, sequence) ? 0 : 1;
+    int reembedChecks = 1;
+    for(int channels = 2; channels <= STEG_MAX_CHANNELS; ++channels) {
+        for(int first = 0; first < (1 << channels) - 1; ++first) {
+            for(int second = 0; second < (1 << channels) - 1; ++second) {
+                for(int third = 0; third < (1 << channels) - 1; ++third) {
+                    sequence.assign(3, StegoSettings());
+                    sequence[0].channelMask = (uint8_t)first;
+                    sequence[1].channelMask = (uint8_t)second;
+                    sequence[2].channelMask = (uint8_t)third;
+                    sequence[2].bitsPerChannel = 2;
+                    reembedFailures += reembed(random, channels, sequence) ? 0 : 1;
+                    reembedChecks++;
+                }
+            }
+        }
+    }
+    printf("%d of %d re-embeddings failed\n", reembedFailures, reembedChecks);
+    return failures == 0 && reembedFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+//!  A PNG filter test.
+/*!
+  A program that applies, scores and reverses the five PNG filters of random rows with the SSE2 kernels and with
+  the scalar reference and checks that they agree byte for byte, for pixels of 3, 4, 6 and 8 bytes and odd row widths.
+  Every row is held in a buffer of exactly its size, so a kernel reading past the row shows up under AddressSanitizer.
+  Build it from the repository root with
+  g++ -std=c++17 -I. tests/PngFiltersTest.cpp PngFilters.cpp LsbKernels.cpp CpuFeatures.cpp -o png-filters-test
+*/
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "PngFilters.h"
+
+//! A function variable.
+/*!
+  A function that fills the bytes with random values, or with values close to 0 and 255 where the Paeth
+  predictor and the Average carry are the most likely to go wrong.
+*/
+static void fillRow(std::mt19937& random, std::vector<uint8_t>& bytes, bool extreme) {
+    for(uint8_t& byte : bytes) {
+        uint8_t value = (uint8_t)random();
+        byte = extreme ? (uint8_t)((value & 1) != 0 ? 255 - (value >> 6) : value >> 6) : value;
+    }
+}
+
+#ifdef CPU_FEATURES_X86
+//! A function variable.
+/*!
+  A function that reverses the filter of type of the row with both kernels and compares the results.
+  Return type: boolean.
+*/
+static bool unfilterAgrees(int type, const std::vector<uint8_t>& filtered, const std::vector<uint8_t>& above, size_t step) {
+    std::vector<uint8_t> expected = filtered;
+    std::vector<uint8_t> actual = filtered;
+    bool expectedResult = unfilterRowScalar(type, expected.data(), above.data(), expected.size(), step);
+    bool actualResult = unfilterRowSSE2(type, actual.data(), above.data(), actual.size(), step);
+    if(expectedResult != actualResult || expected != actual) {
+        printf("unfilter type %d, %zu bytes per pixel, %zu bytes: SSE2 differs from the reference\n", type, step,
+               filtered.size());
+        return false;
+    }
+    return true;
+}
+
+//! A function variable.
+/*!
+  A function that filters the row with every filter type and scores it with both kernels and compares the results.
+  Return type: boolean.
+*/
+static bool filterAgrees(const std::vector<uint8_t>& row, const std::vector<uint8_t>& above, size_t step) {
+    std::vector<uint8_t> expected(row.size());
+    std::vector<uint8_t> actual(row.size());
+    for(int type = 0; type <= 4; ++type) {
+        filterRowScalar(type, row.data(), above.data(), row.size(), step, expected.data());
+        filterRowSSE2(type, row.data(), above.data(), row.size(), step, actual.data());
+        if(expected != actual) {
+            printf("filter type %d, %zu bytes per pixel, %zu bytes: SSE2 differs from the reference\n", type, step,
+                   row.size());
+            return false;
+        }
+    }
+    uint64_t expectedScores[5];
+    uint64_t actualScores[5];
+    filterScoresScalar(row.data(), above.data(), row.size(), step, expectedScores);
+    filterScoresSSE2(row.data(), above.data(), row.size(), step, actualScores);
+    for(int type = 0; type <= 4; ++type) {
+        if(expectedScores[type] != actualScores[type]) {
+            printf("score of filter type %d, %zu bytes per pixel, %zu bytes: SSE2 %llu, reference %llu\n", type, step,
+                   row.size(), (unsigned long long)actualScores[type], (unsigned long long)expectedScores[type]);
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+int main() {
+#ifdef CPU_FEATURES_X86
+    std::mt19937 random(2024);
+    const size_t steps[] = {3, 4, 6, 8};
+    int failures = 0;
+    int checks = 0;
+    int filterFailures = 0;
+    int filterChecks = 0;
+    for(size_t step : steps) {
+        for(size_t pixels = 1; pixels <= 99; pixels += 2) {
+            for(int round = 0; round < 8; ++round) {
+                bool extreme = round % 2 == 1;
+                std::vector<uint8_t> row(pixels * step);
+                std::vector<uint8_t> above(pixels * step);
+                fillRow(random, row, extreme);
+                if(round < 6) {
+                    fillRow(random, above, extreme);
+                }
+                for(int type = 0; type <= 5; ++type) {
+                    failures += unfilterAgrees(type, row, above, step) ? 0 : 1;
+                    checks++;
+                }
+                filterFailures += filterAgrees(row, above, step) ? 0 : 1;
+                filterChecks++;
+            }
+        }
+    }
+    printf("%d of %d unfilter checks failed\n", failures, checks);
+    printf("%d of %d filter and score checks failed\n", filterFailures, filterChecks);
+    return failures == 0 && filterFailures == 0 ? 0 : 1;
+#else
+    printf("The SSE2 kernels are only built for x86 targets\n");
+    return 0;
+#endif
+}
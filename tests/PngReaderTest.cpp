@@ -0,0 +1,213 @@
+//!  A PNG reader test.
+/*!
+  A program that writes small PNG files of every colour type and bit depth, with and without a tRNS chunk,
+  with every filter type and with the image data split over IDAT chunks of random sizes, decodes them with the
+  PngReader and with stbi_load and checks that both return the same size, channel count and bytes.
+  Build it from the repository root with
+  g++ -std=c++17 -pthread -I. tests/PngReaderTest.cpp PngReader.cpp Inflate.cpp MappedFile.cpp PngWriter.cpp Deflate.cpp
+      PngFilters.cpp ThreadPool.cpp LsbKernels.cpp CpuFeatures.cpp -o png-reader-test
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "Deflate.h"
+#include "PngFilters.h"
+#include "PngReader.h"
+#include "PngWriter.h"
+
+//! A structure.
+/*! A structure that stores the form of a generated PNG file. */
+struct PngCase {
+    int width; //!< A variable that stores the image width.
+    int height; //!< A variable that stores the image height.
+    int colorType; //!< A variable that stores the PNG colour type.
+    int bitDepth; //!< A variable that stores the bits per sample.
+    bool transparency; //!< A variable that tells whether the file has a tRNS chunk.
+};
+
+//! A function variable.
+/*!
+  A function that appends the number to the bytes, most significant byte first.
+*/
+static void putBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    for(int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(value >> shift));
+    }
+}
+
+//! A function variable.
+/*!
+  A function that stores a sample of the bit depth at the given index of a packed row.
+*/
+static void putSample(std::vector<uint8_t>& row, size_t index, int bitDepth, uint32_t value) {
+    if(bitDepth == 16) {
+        row[index * 2] = (uint8_t)(value >> 8);
+        row[index * 2 + 1] = (uint8_t)value;
+        return;
+    }
+    size_t bit = index * bitDepth;
+    row[bit / 8] |= (uint8_t)(value << (8 - bitDepth - bit % 8));
+}
+
+//! A function variable.
+/*!
+  A function that returns a PNG file of the case with random pixels, a random filter on every row,
+  an unknown ancillary chunk before the image data and the image data split over IDAT chunks of random sizes.
+*/
+static std::vector<uint8_t> makePng(std::mt19937& random, const PngCase& png) {
+    int samples = png.colorType == 3 ? 1 : (png.colorType & 2 ? 3 : 1) + (png.colorType & 4 ? 1 : 0);
+    int bitsPerPixel = samples * png.bitDepth;
+    size_t rowBytes = ((size_t)png.width * bitsPerPixel + 7) / 8;
+    size_t step = bitsPerPixel < 8 ? 1 : bitsPerPixel / 8;
+    int paletteSize = 1 + (int)(random() % (png.bitDepth == 8 ? 256 : 1u << png.bitDepth));
+    uint32_t sampleLimit = png.colorType == 3 ? (uint32_t)paletteSize : 1u << png.bitDepth;
+
+    std::vector<uint8_t> filtered;
+    std::vector<uint8_t> previous(rowBytes, 0);
+    std::vector<uint8_t> firstPixel;
+    for(int y = 0; y < png.height; ++y) {
+        std::vector<uint8_t> row(rowBytes, 0);
+        for(size_t i = 0; i < (size_t)png.width * samples; ++i) {
+            putSample(row, i, png.bitDepth, random() % sampleLimit);
+        }
+        if(y == 0) {
+            firstPixel.assign(row.begin(), row.begin() + std::max<size_t>(1, bitsPerPixel / 8));
+        }
+        int type = (int)(random() % 5);
+        std::vector<uint8_t> out(rowBytes);
+        filterRowScalar(type, row.data(), previous.data(), rowBytes, step, out.data());
+        filtered.push_back((uint8_t)type);
+        filtered.insert(filtered.end(), out.begin(), out.end());
+        previous = row;
+    }
+
+    std::vector<uint8_t> file = {137, 80, 78, 71, 13, 10, 26, 10};
+    std::vector<uint8_t> header;
+    putBigEndian32(header, (uint32_t)png.width);
+    putBigEndian32(header, (uint32_t)png.height);
+    header.insert(header.end(), {(uint8_t)png.bitDepth, (uint8_t)png.colorType, 0, 0, 0});
+    putPngChunk(file, "IHDR", header.data(), header.size(), pngChunkCrc("IHDR", header.data(), header.size()));
+    std::vector<uint8_t> text = {'t', 'e', 's', 't'};
+    putPngChunk(file, "teST", text.data(), text.size(), pngChunkCrc("teST", text.data(), text.size()));
+    if(png.colorType == 3) {
+        std::vector<uint8_t> palette(paletteSize * 3);
+        for(uint8_t& byte : palette) {
+            byte = (uint8_t)random();
+        }
+        putPngChunk(file, "PLTE", palette.data(), palette.size(), pngChunkCrc("PLTE", palette.data(), palette.size()));
+    }
+    if(png.transparency) {
+        std::vector<uint8_t> transparency;
+        if(png.colorType == 3) {
+            transparency.resize(1 + random() % paletteSize);
+            for(uint8_t& byte : transparency) {
+                byte = (uint8_t)random();
+            }
+        }
+        else {
+            // The transparent colour is the first pixel, so some pixels turn transparent.
+            for(int k = 0; k < samples; ++k) {
+                uint32_t value = png.bitDepth == 16 ? (uint32_t)(firstPixel[2 * k] << 8 | firstPixel[2 * k + 1])
+                               : png.bitDepth == 8 ? firstPixel[k] : (uint32_t)(firstPixel[0] >> (8 - png.bitDepth));
+                transparency.push_back((uint8_t)(value >> 8));
+                transparency.push_back((uint8_t)value);
+            }
+        }
+        putPngChunk(file, "tRNS", transparency.data(), transparency.size(),
+                    pngChunkCrc("tRNS", transparency.data(), transparency.size()));
+    }
+
+    std::vector<uint8_t> stream = {0x78, 0x01};
+    Deflater deflater(16);
+    deflater.compress(filtered.data(), 0, filtered.size(), true, stream);
+    putBigEndian32(stream, adler32(1, filtered.data(), filtered.size()));
+    for(size_t begin = 0; begin < stream.size();) {
+        size_t size = std::min<size_t>(stream.size() - begin, random() % 3 == 0 ? random() % 4 : 1 + random() % 64);
+        putPngChunk(file, "IDAT", stream.data() + begin, size, pngChunkCrc("IDAT", stream.data() + begin, size));
+        begin += size;
+    }
+    putPngChunk(file, "IEND", nullptr, 0, pngChunkCrc("IEND", nullptr, 0));
+    return file;
+}
+
+//! A function variable.
+/*!
+  A function that writes the PNG file of the case, decodes it with both readers and compares them.
+  The PngReader rows are read in two calls, so a reader that loses its place between calls shows up.
+  Return type: boolean.
+*/
+static bool readersAgree(std::mt19937& random, const PngCase& png, const std::string& path) {
+    std::vector<uint8_t> file = makePng(random, png);
+    FILE* out = fopen(path.c_str(), "wb");
+    if(out == nullptr || fwrite(file.data(), 1, file.size(), out) != file.size() || fclose(out) != 0) {
+        printf("Failed to write %s\n", path.c_str());
+        return false;
+    }
+    int w = 0;
+    int h = 0;
+    int channels = 0;
+    uint8_t* expected = stbi_load(path.c_str(), &w, &h, &channels, 0);
+    PngReader reader;
+    bool opened = reader.open(path.c_str());
+    bool same = expected != nullptr && opened && reader.width == w && reader.height == h && reader.channels == channels;
+    if(same) {
+        size_t rowSize = (size_t)w * channels;
+        std::vector<uint8_t> rows((size_t)h * rowSize);
+        int first = h / 2;
+        same = reader.readRows(rows.data(), first) && reader.readRows(rows.data() + first * rowSize, h - first)
+               && memcmp(rows.data(), expected, rows.size()) == 0;
+    }
+    if(!same) {
+        printf("colour type %d, depth %d, %s tRNS, %d x %d: PngReader %s, stbi_load %d channels\n", png.colorType,
+               png.bitDepth, png.transparency ? "with" : "without", png.width, png.height,
+               opened ? "differs" : "failed to open", channels);
+    }
+    stbi_image_free(expected);
+    return same;
+}
+
+int main() {
+    char path[] = "/tmp/png-reader-test-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        printf("Failed to create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+    std::mt19937 random(2024);
+    const int colorTypes[] = {0, 2, 3, 4, 6};
+    const int depths[] = {1, 2, 4, 8, 16};
+    const int widths[] = {1, 3, 7, 13, 33};
+    int failures = 0;
+    int checks = 0;
+    for(int colorType : colorTypes) {
+        for(int bitDepth : depths) {
+            if((colorType == 3 && bitDepth == 16) || ((colorType == 2 || colorType == 4 || colorType == 6) && bitDepth < 8)) {
+                continue;
+            }
+            for(int width : widths) {
+                for(int round = 0; round < 8; ++round) {
+                    bool transparency = round % 2 == 1;
+                    if(transparency && (colorType == 4 || colorType == 6)) {
+                        continue;
+                    }
+                    PngCase png = {width, 1 + (int)(random() % 9), colorType, bitDepth, transparency};
+                    failures += readersAgree(random, png, path) ? 0 : 1;
+                    checks++;
+                }
+            }
+        }
+    }
+    unlink(path);
+    printf("%d of %d PNG files decoded differently\n", failures, checks);
+    return failures == 0 ? 0 : 1;
+}